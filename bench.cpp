@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+
+#include "cell_extractor.h"
+#include "cell_pipeline.h"
+#include "cell_stats.h"
+#include "coord_kernel.h"
+#include "extraction_rules.h"
+#include "geometry_stage.h"
+#include "output_sink.h"
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "miniz.h"
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// 合成几何的规模：要素数 × 每个要素的顶点数，分别对应总图、港口图和密集测量图幅中的典型面要素
+struct Profile {
+    const char* name;
+    int features;
+    int vertices;
+};
+
+const Profile kProfiles[] = {
+    {"small", 4000, 16},
+    {"medium", 1000, 256},
+    {"dense", 100, 4096},
+};
+
+// 一次测量：耗时及处理的对象数、字节数
+struct Measurement {
+    double seconds = 0;
+    std::uint64_t items = 0;
+    std::uint64_t bytes = 0;
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 重复运行 iterations 次，取耗时的中位数，减小偶发抖动的影响
+template <typename Run>
+Measurement median_of(int iterations, Run&& run) {
+    std::vector<Measurement> runs;
+    for (int i = 0; i < iterations; ++i) {
+        runs.push_back(run());
+    }
+    std::sort(runs.begin(), runs.end(),
+              [](const Measurement& a, const Measurement& b) { return a.seconds < b.seconds; });
+    return runs[runs.size() / 2];
+}
+
+void report(const std::string& stage, const Measurement& m, const char* unit) {
+    const double seconds = std::max(m.seconds, 1e-9);
+    std::printf("%-28s %10.2f ms %14.0f %s/s %10.2f MB/s\n", stage.c_str(), m.seconds * 1e3, m.items / seconds,
+                unit, m.bytes / seconds / (1 << 20));
+}
+
+// 带随机扰动的近似圆形面，相邻顶点间距远小于简化容差，接近海图中数字化的岸线和等深线
+std::vector<OGRGeometryUniquePtr> make_polygons(const Profile& profile, std::mt19937& rng) {
+    std::uniform_real_distribution<double> centre(-1.0, 1.0);
+    std::uniform_real_distribution<double> noise(-0.02, 0.02);
+    std::vector<OGRGeometryUniquePtr> polygons;
+    for (int f = 0; f < profile.features; ++f) {
+        const double cx = centre(rng);
+        const double cy = centre(rng);
+        auto* ring = new OGRLinearRing();
+        for (int v = 0; v < profile.vertices; ++v) {
+            const double angle = 2 * kPi * v / profile.vertices;
+            const double radius = 0.05 * (1 + noise(rng));
+            ring->addPoint(cx + radius * std::cos(angle), cy + radius * std::sin(angle));
+        }
+        ring->closeRings();
+        auto* polygon = new OGRPolygon();
+        polygon->addRingDirectly(ring);
+        polygons.emplace_back(polygon);
+    }
+    return polygons;
+}
+
+// 只统计字节数、不落盘的输出端，用于端到端测量提取本身的吞吐量
+class NullSink : public OutputSink {
+public:
+    bool write(const CellResult& result) override {
+        m_bytes += result.header.size() + result.rows.size();
+        return true;
+    }
+    bool close() override { return true; }
+
+    std::uint64_t bytes() const { return m_bytes; }
+
+private:
+    std::uint64_t m_bytes = 0;
+};
+
+// 所有合成几何经过几何处理和序列化后的 CSV 行，作为写出和压缩阶段的输入
+CellResult bench_geometry(int iterations, double tolerance) {
+    CellResult csv;
+    csv.header = "WKT,LAYERS,DEPTH\n";
+    for (const Profile& profile : kProfiles) {
+        std::mt19937 rng(20240101); // 固定种子，每次运行的输入完全相同
+        const std::vector<OGRGeometryUniquePtr> polygons = make_polygons(profile, rng);
+        const std::uint64_t vertices = static_cast<std::uint64_t>(profile.features) * profile.vertices;
+
+        std::vector<OGRGeometryUniquePtr> simplified;
+        CellStats stats;
+        for (int i = 0; i < iterations; ++i) {
+            simplified.clear();
+            for (const auto& polygon : polygons) {
+                simplified.push_back(simplify_and_make_valid(polygon.get(), tolerance, &stats));
+            }
+        }
+        Measurement simplify{stats[Stage::Simplify] / iterations, vertices, 0};
+        Measurement precheck{stats[Stage::Precheck] / iterations, vertices, 0};
+        Measurement makeValid{stats[Stage::MakeValid] / iterations, vertices, 0};
+        report(std::string("simplify/") + profile.name, simplify, "vertex");
+        report(std::string("precheck/") + profile.name, precheck, "vertex");
+        report(std::string("makevalid/") + profile.name, makeValid, "vertex");
+
+        // 量化作用于简化后的几何，每次在副本上运行
+        const Measurement quantize = median_of(iterations, [&] {
+            std::vector<OGRGeometryUniquePtr> copies;
+            for (const auto& geom : simplified) {
+                copies.emplace_back(geom ? geom->clone() : nullptr);
+            }
+            std::uint64_t count = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto& geom : copies) {
+                if (geom) {
+                    quantize_geometry(*geom, kWktGrid);
+                    count += count_vertices(geom.get());
+                }
+            }
+            return Measurement{seconds_since(start), count, 0};
+        });
+        report(std::string("quantize-") + coord_kernel_name() + "/" + profile.name, quantize, "vertex");
+
+        std::string rows;
+        const Measurement wkt = median_of(iterations, [&] {
+            rows.clear();
+            RowEncoder encoder(OutputFormat::Csv);
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto& geom : simplified) {
+                encoder.begin(rows, geom.get());
+                encoder.add_string(rows, "DEPARE");
+                encoder.add_real(rows, 12.5);
+                encoder.end(rows);
+            }
+            return Measurement{seconds_since(start), simplified.size(), rows.size()};
+        });
+        report(std::string("wkt/") + profile.name, wkt, "row");
+        csv.rows += rows;
+    }
+    return csv;
+}
+
+void bench_output(int iterations, const CellResult& csv, const fs::path& tempDir) {
+    // 把合成数据重复成约 64 MB，接近一次完整导出中写出线程处理的数据量
+    CellResult data;
+    data.header = csv.header;
+    while (!csv.rows.empty() && data.rows.size() < (64u << 20)) {
+        data.rows += csv.rows;
+    }
+
+    const Measurement write = median_of(iterations, [&] {
+        const auto start = std::chrono::steady_clock::now();
+        CsvFileSink sink((tempDir / "bench.csv").string());
+        sink.write(data);
+        sink.close();
+        return Measurement{seconds_since(start), 1, data.rows.size()};
+    });
+    report("csv-write", write, "file");
+
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned zipThreads : {1u, threads}) {
+        const Measurement zip = median_of(iterations, [&] {
+            const auto start = std::chrono::steady_clock::now();
+            ZipFileSink sink((tempDir / "bench.zip").string(), "bench.csv", MZ_DEFAULT_LEVEL, zipThreads);
+            sink.write(data);
+            sink.close();
+            return Measurement{seconds_since(start), 1, data.rows.size()};
+        });
+        report("zip/threads=" + std::to_string(zipThreads), zip, "file");
+    }
+}
+
+void bench_cells(int iterations, const std::string& inputDir, unsigned jobs) {
+    const std::vector<S57Cell> cells = collect_s57_cells(inputDir);
+    if (cells.empty()) {
+        std::cerr << "警告: " << inputDir << " 中没有找到 .000 文件，跳过图幅测量" << std::endl;
+        return;
+    }
+    std::uint64_t inputBytes = 0;
+    for (const S57Cell& cell : cells) {
+        inputBytes += cell.bytes;
+    }
+
+    const DepthRules depthRules(DepthRules::default_depth_fields(), "LNDARE");
+    const FieldFilterRules nobjnmRules({"LNDARE", "DEPARE", "SEAARE", "HRBFAC", "BRIDGE"}, "NOBJNM");
+
+    const Measurement open = median_of(iterations, [&] {
+        const auto start = std::chrono::steady_clock::now();
+        for (const S57Cell& cell : cells) {
+            open_s57_cell(cell, depthRules.open_options());
+        }
+        return Measurement{seconds_since(start), cells.size(), inputBytes};
+    });
+    report("open", open, "cell");
+
+    const Measurement scan = median_of(iterations, [&] {
+        Measurement m;
+        m.bytes = inputBytes;
+        for (const S57Cell& cell : cells) {
+            GdalDatasetPtr poDS = open_s57_cell(cell, depthRules.open_options());
+            if (!poDS) {
+                continue;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            for (int l = 0; l < poDS->GetLayerCount(); ++l) {
+                for (auto& poFeature : *poDS->GetLayer(l)) {
+                    (void)poFeature;
+                    ++m.items;
+                }
+            }
+            m.seconds += seconds_since(start); // 只计读取要素，不计打开
+        }
+        return m;
+    });
+    report("scan", scan, "feature");
+
+    // 端到端：两组规则共用一次打开，结果交给不落盘的输出端
+    const std::vector<const ExtractionRules*> rules = {&depthRules, &nobjnmRules};
+    const ExtractSettings settings;
+    std::uint64_t features = 0;
+    const Measurement endToEnd = median_of(iterations, [&] {
+        NullSink depthSink;
+        NullSink nobjnmSink;
+        std::vector<CellStats> stats;
+        const auto start = std::chrono::steady_clock::now();
+        run_cell_pipeline(cells, jobs,
+                          [&](const S57Cell& cell, std::size_t, const std::vector<bool>& wanted,
+                              std::vector<CellResult>& results, CellStats* cellStats) {
+                              extract_cell(cell, rules, wanted, settings, results, cellStats);
+                          },
+                          {PipelineOutput{&depthSink}, PipelineOutput{&nobjnmSink}}, 0, &stats);
+        const double seconds = seconds_since(start);
+        features = 0;
+        for (const CellStats& cell : stats) {
+            features += cell.features;
+        }
+        return Measurement{seconds, cells.size(), depthSink.bytes() + nobjnmSink.bytes()};
+    });
+    // 第一行的 MB/s 按输出字节计，第二行按输入图幅的文件大小计
+    report("end-to-end/jobs=" + std::to_string(jobs), endToEnd, "cell");
+    report("end-to-end/input", Measurement{endToEnd.seconds, features, inputBytes}, "feature");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    po::options_description desc("S57 Export Benchmark Options");
+    desc.add_options()
+        ("help,h", "显示帮助信息")
+        ("input-dir,i", po::value<std::string>(), "S57 图幅目录，用于测量打开、读取和端到端吞吐量 (不指定时只运行合成数据的测量)")
+        ("iterations", po::value<int>()->default_value(5), "每项测量的重复次数，报告耗时的中位数")
+        ("jobs,j", po::value<unsigned>()->default_value(0), "端到端测量的工作线程数 (0 表示使用全部CPU核心)")
+        ("tolerance", po::value<double>()->default_value(0.00025), "合成几何的简化容差 (度)");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        po::notify(vm);
+    } catch (const po::error& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        std::cerr << desc << std::endl;
+        return 1;
+    }
+    const int iterations = std::max(1, vm["iterations"].as<int>());
+
+    GDALAllRegister();
+    CPLSetConfigOption("OGR_WKT_PRECISION", "8");
+
+    const fs::path tempDir = fs::temp_directory_path() / fs::unique_path("s57bench-%%%%-%%%%");
+    fs::create_directories(tempDir);
+
+    std::printf("%-28s %13s %20s %15s\n", "阶段", "耗时", "吞吐量", "数据量");
+    const CellResult csv = bench_geometry(iterations, vm["tolerance"].as<double>());
+    bench_output(iterations, csv, tempDir);
+    if (vm.count("input-dir")) {
+        bench_cells(iterations, vm["input-dir"].as<std::string>(), vm["jobs"].as<unsigned>());
+    }
+
+    fs::remove_all(tempDir);
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include "cell_catalog.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+
+#include "cell_scanner.h"
+#include "csv_format.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+constexpr const char* kCatalogMagic = "# s57 cell catalog v1";
+
+// 航行用途记录在 DSID 图层唯一要素的 DSID_INTU 字段中
+int read_usage(GDALDataset& dataset) {
+    OGRLayer* poLayer = dataset.GetLayerByName("DSID");
+    if (!poLayer) {
+        return 0;
+    }
+    const int index = poLayer->GetLayerDefn()->GetFieldIndex("DSID_INTU");
+    if (index < 0) {
+        return 0;
+    }
+    poLayer->ResetReading();
+    OGRFeatureUniquePtr poFeature(poLayer->GetNextFeature());
+    poLayer->ResetReading();
+    return poFeature ? poFeature->GetFieldAsInteger(index) : 0;
+}
+
+// 有几何的图层都返回整个图幅的范围 (OGRS57DataSource::GetDSExtent)，取其一即可
+bool read_extent(GDALDataset& dataset, CellCatalog::Entry& entry) {
+    for (int i = 0; i < dataset.GetLayerCount(); ++i) {
+        OGRLayer* poLayer = dataset.GetLayer(i);
+        OGREnvelope extent;
+        if (poLayer->GetExtent(&extent, TRUE) != OGRERR_NONE) {
+            continue; // DSID 和集合物标等无几何的图层
+        }
+        entry.minX = extent.MinX;
+        entry.minY = extent.MinY;
+        entry.maxX = extent.MaxX;
+        entry.maxY = extent.MaxY;
+        return true;
+    }
+    return false;
+}
+
+// 图幅路径是否由扫描 inputDir 得到：扫描器以 inputDir 为前缀拼接路径，压缩包中的图幅另加 /vsizip/ 等前缀
+bool under_input_dir(const std::string& path, const std::string& inputDir) {
+    for (const char* prefix : {"", "/vsizip/", "/vsitar/"}) {
+        const std::string root = prefix + inputDir;
+        if (root.empty() || path.compare(0, root.size(), root) != 0) {
+            continue;
+        }
+        // 避免 /data/a 匹配 /data/ab 下的图幅
+        const char next = path.size() > root.size() ? path[root.size()] : '/';
+        const char last = root.back();
+        if (last == '/' || last == '\\' || next == '/' || next == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> items;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, separator)) {
+        items.push_back(item);
+    }
+    return items;
+}
+
+} // namespace
+
+bool CellCatalog::Entry::has_layer(const std::string& name) const {
+    return std::binary_search(layers.begin(), layers.end(), name);
+}
+
+CellCatalog::CellCatalog(std::string path) : m_path(std::move(path)) {}
+
+void CellCatalog::load() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+
+    std::ifstream in(m_path);
+    std::string line;
+    if (!std::getline(in, line) || line != kCatalogMagic) {
+        return;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string path, updates, size, mtime, usage, extent, layers;
+        if (!std::getline(fields, path, '\t') || !std::getline(fields, updates, '\t') ||
+            !std::getline(fields, size, '\t') || !std::getline(fields, mtime, '\t') ||
+            !std::getline(fields, usage, '\t') || !std::getline(fields, extent, '\t')) {
+            continue;
+        }
+        std::getline(fields, layers); // 不含任何图层的图幅该字段为空
+        try {
+            Entry entry;
+            entry.fingerprint.updates = std::stoull(updates);
+            entry.fingerprint.size = std::stoull(size);
+            entry.fingerprint.mtime = static_cast<std::time_t>(std::stoll(mtime));
+            entry.usage = std::stoi(usage);
+            if (extent != "-") {
+                const std::vector<std::string> bounds = split(extent, ',');
+                if (bounds.size() != 4) {
+                    continue;
+                }
+                entry.minX = std::stod(bounds[0]);
+                entry.minY = std::stod(bounds[1]);
+                entry.maxX = std::stod(bounds[2]);
+                entry.maxY = std::stod(bounds[3]);
+                entry.hasExtent = true;
+            }
+            entry.layers = split(layers, ',');
+            std::sort(entry.layers.begin(), entry.layers.end());
+            m_entries[path] = std::move(entry);
+        } catch (const std::exception&) {
+            continue; // 损坏的行忽略，图幅下次打开时重新记录
+        }
+    }
+}
+
+bool CellCatalog::lookup(const S57Cell& cell, Entry& entry) const {
+    CellFingerprint fingerprint;
+    if (!stat_cell(cell, fingerprint)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(cell.path);
+    if (it == m_entries.end()) {
+        return false;
+    }
+    const CellFingerprint& known = it->second.fingerprint;
+    if (known.updates != fingerprint.updates || known.size != fingerprint.size || known.mtime != fingerprint.mtime) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+void CellCatalog::record(const S57Cell& cell, GDALDataset& dataset) {
+    Entry entry;
+    if (!stat_cell(cell, entry.fingerprint)) {
+        return;
+    }
+    for (int i = 0; i < dataset.GetLayerCount(); ++i) {
+        entry.layers.push_back(dataset.GetLayer(i)->GetName());
+    }
+    std::sort(entry.layers.begin(), entry.layers.end());
+    entry.usage = read_usage(dataset);
+    entry.hasExtent = read_extent(dataset, entry);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[cell.path] = std::move(entry);
+}
+
+void CellCatalog::prune(const std::string& inputDir, const std::vector<S57Cell>& cells) {
+    std::set<std::string> scanned;
+    for (const S57Cell& cell : cells) {
+        scanned.insert(cell.path);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (under_input_dir(it->first, inputDir) && !scanned.count(it->first)) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool CellCatalog::save() const {
+    const std::string tmpPath = m_path + ".tmp";
+    // 同一目录的多个作业可能同时保存，临时文件的写入和改名都在锁内完成
+    std::lock_guard<std::mutex> lock(m_mutex);
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        out << kCatalogMagic << '\n';
+        for (const auto& [path, entry] : m_entries) {
+            std::string extent = "-";
+            if (entry.hasExtent) {
+                extent.clear();
+                for (double value : {entry.minX, entry.minY, entry.maxX, entry.maxY}) {
+                    if (!extent.empty()) {
+                        extent += ',';
+                    }
+                    append_csv_real(extent, value);
+                }
+            }
+            out << path << '\t' << entry.fingerprint.updates << '\t' << entry.fingerprint.size << '\t'
+                << static_cast<long long>(entry.fingerprint.mtime) << '\t' << entry.usage << '\t' << extent << '\t';
+            for (std::size_t l = 0; l < entry.layers.size(); ++l) {
+                out << (l ? "," : "") << entry.layers[l];
+            }
+            out << '\n';
+        }
+        if (!out) {
+            std::cerr << "错误: 无法写入图幅目录 " << tmpPath << std::endl;
+            return false;
+        }
+    }
+    boost::system::error_code ec;
+    fs::rename(tmpPath, m_path, ec);
+    if (ec) {
+        std::cerr << "错误: 无法更新图幅目录 " << m_path << ": " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
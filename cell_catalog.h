@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "incremental_cache.h"
+
+class GDALDataset;
+struct S57Cell;
+
+/**
+ * @brief 图幅目录：持久化记录每个图幅包含哪些物标类 (图层)、航行用途和范围
+ *
+ * 图幅第一次被打开时记录下来，保存在目录文件中。再次运行时更新链长度、
+ * 总大小和最新修改时间都没变的图幅直接使用记录，不含任何目标图层的图幅
+ * 因此不必再打开和解析。S57 驱动的字段由物标类决定而不是由图幅决定，
+ * 所以只需要记录图层。
+ *
+ * 目录只依赖图幅内容，与导出参数无关，不同规则、不同工具可以共用一个目录文件；
+ * 服务模式下输入目录不同的作业也共用内存中的同一个目录 (见 run_export_tool)。
+ */
+class CellCatalog {
+public:
+    struct Entry {
+        CellFingerprint fingerprint;     // 不含内容哈希
+        int usage = 0;                   // DSID_INTU 航行用途 (1-6)，0 表示未知
+        bool hasExtent = false;
+        double minX = 0, minY = 0, maxX = 0, maxY = 0; // 图幅范围 (经纬度)
+        std::vector<std::string> layers; // 图幅中的图层名，已排序
+
+        bool has_layer(const std::string& name) const;
+    };
+
+    explicit CellCatalog(std::string path);
+
+    /**
+     * @brief 读取目录文件，文件不存在或格式不符时目录为空
+     */
+    void load();
+
+    /**
+     * @brief 查找图幅的记录，图幅不在目录中或已变化时返回 false (线程安全)
+     */
+    bool lookup(const S57Cell& cell, Entry& entry) const;
+
+    /**
+     * @brief 记录刚打开的图幅 (线程安全)
+     */
+    void record(const S57Cell& cell, GDALDataset& dataset);
+
+    /**
+     * @brief 删除输入目录 (或其中的压缩包) 下已不存在的图幅的记录 (线程安全)
+     *
+     * @param cells 本次扫描 inputDir 得到的全部图幅；其它输入目录的记录保持不变
+     */
+    void prune(const std::string& inputDir, const std::vector<S57Cell>& cells);
+
+    /**
+     * @brief 写出目录文件 (线程安全)
+     */
+    bool save() const;
+
+private:
+    std::string m_path;
+    mutable std::mutex m_mutex;
+    std::map<std::string, Entry> m_entries; // 按图幅路径索引
+};
@@ -0,0 +1,404 @@
+#include "cell_extractor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+
+#include "cell_catalog.h"
+#include "cell_stats.h"
+#include "edge_simplifier.h"
+#include "extraction_rules.h"
+#include "geometry_cache.h"
+#include "geometry_stage.h"
+
+void gdal_dataset_deleter(GDALDataset* ds) {
+    if (ds) {
+        GDALClose(ds);
+    }
+}
+
+GdalDatasetPtr open_s57_cell(const S57Cell& cell, const std::vector<std::string>& openOptions) {
+    std::vector<const char*> papszOpenOptions;
+    for (const std::string& option : openOptions) {
+        papszOpenOptions.push_back(option.c_str());
+    }
+    papszOpenOptions.push_back(nullptr); // 数组必须以NULL结尾
+
+    const char* const papszDrivers[] = {"S57", nullptr};
+    return GdalDatasetPtr(
+        static_cast<GDALDataset*>(GDALOpenEx((cell.openPath.empty() ? cell.path : cell.openPath).c_str(),
+                                             GDAL_OF_VECTOR, papszDrivers,
+                                             papszOpenOptions.data(), nullptr)),
+        &gdal_dataset_deleter
+    );
+}
+
+namespace {
+
+// 共用一次打开的一组规则
+struct OpenGroup {
+    std::vector<std::string> options;
+    std::vector<std::size_t> members;
+};
+
+bool accepts_options(const ExtractionRules& rules, const std::vector<std::string>& options) {
+    const std::vector<std::string> own = rules.open_options();
+    for (const std::string& option : options) {
+        if (std::find(own.begin(), own.end(), option) == own.end() && !rules.tolerates_open_option(option)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<OpenGroup> group_by_open_options(const std::vector<const ExtractionRules*>& rules,
+                                             const std::vector<bool>& wanted) {
+    std::vector<OpenGroup> groups;
+    for (std::size_t r = 0; r < rules.size(); ++r) {
+        if (!wanted[r]) {
+            continue;
+        }
+        bool joined = false;
+        for (OpenGroup& group : groups) {
+            std::vector<std::string> merged = group.options;
+            for (const std::string& option : rules[r]->open_options()) {
+                if (std::find(merged.begin(), merged.end(), option) == merged.end()) {
+                    merged.push_back(option);
+                }
+            }
+            bool compatible = accepts_options(*rules[r], merged);
+            for (std::size_t m : group.members) {
+                compatible = compatible && accepts_options(*rules[m], merged);
+            }
+            if (compatible) {
+                group.options = std::move(merged);
+                group.members.push_back(r);
+                joined = true;
+                break;
+            }
+        }
+        if (!joined) {
+            groups.push_back(OpenGroup{rules[r]->open_options(), {r}});
+        }
+    }
+    return groups;
+}
+
+// 一组规则在一个图层上的提取器，以及该图层的输出缓冲
+struct Binding {
+    std::size_t rule;
+    std::unique_ptr<LayerExtractor> extractor;
+    CellResult* part;
+};
+
+void append_part(CellResult& result, CellResult& part) {
+    result.rows += part.rows;
+    result.rowCount += part.rowCount;
+    result.rowInfo.insert(result.rowInfo.end(), part.rowInfo.begin(), part.rowInfo.end());
+}
+
+// 点或多点要素逐点输出 (LayerExtractor::explode_points)，直接由坐标生成行
+void encode_points(const OGRFeature& feature, const LayerExtractor& extractor, RowEncoder& encoder,
+                   const ExtractSettings& settings, CellResult& out, CellStats* stats) {
+    const OGRGeometry* poGeom = feature.GetGeometryRef();
+    if (!poGeom) {
+        return;
+    }
+    StageTimer timer(stats, Stage::Serialize);
+    auto encode_one = [&](const OGRPoint& point) {
+        if (point.IsEmpty() || (settings.bbox && !settings.bbox->contains(point.getX(), point.getY()))) {
+            return; // 与 SPLIT_MULTIPOINT 时逐点按范围过滤的结果一致
+        }
+        if (stats) {
+            ++stats->rows;
+            ++stats->vertices;
+        }
+        const std::size_t rowStart = out.rows.size();
+        encoder.begin_point(out.rows, point.getX(), point.getY());
+        extractor.encode_point(feature, point.getZ(), encoder, out.rows);
+        const std::uint64_t key = encoder.end(out.rows);
+        ++out.rowCount;
+        if (settings.tileSize > 0 || settings.dedup) {
+            RowInfo info;
+            info.size = out.rows.size() - rowStart;
+            info.key = key;
+            if (settings.tileSize > 0) {
+                assign_point_tile(info, point.getX(), point.getY(), settings.tileSize);
+            }
+            out.rowInfo.push_back(info);
+        }
+    };
+    switch (wkbFlatten(poGeom->getGeometryType())) {
+        case wkbPoint:
+            encode_one(*poGeom->toPoint());
+            break;
+        case wkbMultiPoint: {
+            const OGRGeometryCollection* poColl = poGeom->toGeometryCollection();
+            for (int i = 0; i < poColl->getNumGeometries(); ++i) {
+                encode_one(*poColl->getGeometryRef(i)->toPoint());
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void extract_group(const S57Cell& cell, const std::vector<const ExtractionRules*>& rules, const OpenGroup& group,
+                   const ExtractSettings& settings, CellGeometryCache* geometryCache, CellCatalog*& catalog,
+                   std::vector<CellResult>& results, std::vector<std::ostringstream>& logs, CellStats* stats) {
+    GdalDatasetPtr poDS(nullptr, &gdal_dataset_deleter);
+    {
+        StageTimer timer(stats, Stage::Open);
+        poDS = open_s57_cell(cell, group.options);
+    }
+    if (!poDS) {
+        results[group.members.front()].errors = "警告: 无法打开文件 " + cell.path + "\n";
+        return;
+    }
+    if (catalog) {
+        catalog->record(cell, *poDS); // 图层与打开选项无关，每个图幅只需记录一次
+        catalog = nullptr;
+    }
+
+    // 只有一组规则时图层顺序就是它自己的顺序，直接写入结果；多组规则时先按
+    // (规则, 图层) 分别缓冲，最后按各自的图层顺序拼接
+    bool direct = group.members.size() == 1;
+    if (direct) {
+        std::vector<std::string> layers = rules[group.members.front()]->layers();
+        std::sort(layers.begin(), layers.end());
+        direct = std::adjacent_find(layers.begin(), layers.end()) == layers.end(); // 图层重复时同样需要分别缓冲
+    }
+    std::vector<std::vector<CellResult>> parts(rules.size());
+    std::vector<std::string> layerOrder;                     // 合并后的图层，按第一次出现的顺序
+    std::vector<std::vector<Binding>> layerBindings;          // 与 layerOrder 一一对应
+    std::vector<bool> found(rules.size(), false);
+
+    for (std::size_t r : group.members) {
+        const std::vector<std::string>& layers = rules[r]->layers();
+        if (!direct) {
+            parts[r].resize(layers.size());
+        }
+        for (std::size_t l = 0; l < layers.size(); ++l) {
+            const std::string& layerName = layers[l];
+            OGRLayer* poLayer = poDS->GetLayerByName(layerName.c_str());
+            if (!poLayer) {
+                continue;
+            }
+            std::unique_ptr<LayerExtractor> extractor = rules[r]->bind(*poLayer, layerName, cell, logs[r]);
+            if (!extractor) {
+                continue;
+            }
+            found[r] = true;
+
+            auto it = std::find(layerOrder.begin(), layerOrder.end(), layerName);
+            if (it == layerOrder.end()) {
+                layerOrder.push_back(layerName);
+                layerBindings.emplace_back();
+                it = layerOrder.end() - 1;
+            }
+            layerBindings[it - layerOrder.begin()].push_back(
+                Binding{r, std::move(extractor), direct ? &results[r] : &parts[r][l]});
+        }
+    }
+
+    // 读取要素的耗时 (Stage::Scan) 为遍历图层的总耗时减去循环内单独计时的阶段
+    auto inner_seconds = [&] {
+        return (*stats)[Stage::Filter] + (*stats)[Stage::Simplify] + (*stats)[Stage::Quantize] +
+               (*stats)[Stage::Precheck] + (*stats)[Stage::MakeValid] + (*stats)[Stage::Serialize];
+    };
+    const auto scanStart = stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    const double innerStart = stats ? inner_seconds() : 0;
+
+    RowEncoder encoder(settings.format, settings.dedup);
+    const double tolerance = settings.tolerances.get(cell_level(cell));
+    std::unique_ptr<SharedEdgeSimplifier> edges;
+    if (settings.sharedEdges) {
+        edges = std::make_unique<SharedEdgeSimplifier>(*poDS, tolerance);
+    }
+    for (std::size_t l = 0; l < layerOrder.size(); ++l) {
+        const std::string& layerName = layerOrder[l];
+        OGRLayer* poLayer = poDS->GetLayerByName(layerName.c_str());
+        std::vector<Binding>& bindings = layerBindings[l];
+        const int rcidIndex = geometryCache ? poLayer->GetLayerDefn()->GetFieldIndex("RCID") : -1;
+        if (settings.bbox) {
+            poLayer->SetSpatialFilterRect(settings.bbox->minX, settings.bbox->minY, settings.bbox->maxX,
+                                          settings.bbox->maxY);
+        }
+
+        for (auto& poFeature : *poLayer) {
+            if (stats) {
+                ++stats->features;
+            }
+            OGRGeometryUniquePtr poGeom;
+            bool simplified = false; // 先按属性过滤，至少一个提取器接受时才处理几何
+            for (Binding& binding : bindings) {
+                bool accepted;
+                {
+                    StageTimer timer(stats, Stage::Filter);
+                    accepted = binding.extractor->accept(*poFeature);
+                }
+                if (!accepted) {
+                    continue;
+                }
+                if (binding.extractor->explode_points()) {
+                    encode_points(*poFeature, *binding.extractor, encoder, settings, *binding.part, stats);
+                    continue;
+                }
+                if (!simplified) {
+                    if (edges && edges->simplify_and_make_valid(*poFeature, stats, settings.grid, poGeom)) {
+                        // 由简化后的共享边组装
+                    } else if (rcidIndex >= 0) {
+                        poGeom = geometryCache->simplify_and_make_valid(
+                            layerName, poFeature->GetFieldAsInteger64(rcidIndex), poFeature->GetGeometryRef(),
+                            tolerance, stats, settings.grid);
+                    } else {
+                        poGeom = simplify_and_make_valid(poFeature->GetGeometryRef(), tolerance, stats, settings.grid);
+                    }
+                    simplified = true;
+                }
+
+                const OGRGeometry* geom = poGeom.get();
+                OGRGeometryUniquePtr flat;
+                if (geom && rules[binding.rule]->flatten() && geom->getCoordinateDimension() > 2) {
+                    if (bindings.size() == 1) {
+                        poGeom->flattenTo2D(); // 等价于 -dim 2
+                    } else {
+                        flat.reset(geom->clone()); // 其他规则可能需要保留 Z
+                        flat->flattenTo2D();
+                        geom = flat.get();
+                    }
+                }
+
+                if (stats) {
+                    ++stats->rows;
+                    stats->vertices += count_vertices(geom);
+                }
+                StageTimer timer(stats, Stage::Serialize);
+                CellResult& out = *binding.part;
+                const std::size_t rowStart = out.rows.size();
+                encoder.begin(out.rows, geom);
+                binding.extractor->encode(*poFeature, encoder, out.rows);
+                const std::uint64_t key = encoder.end(out.rows);
+                ++out.rowCount;
+                if (settings.tileSize > 0 || settings.dedup) {
+                    RowInfo info;
+                    info.size = out.rows.size() - rowStart;
+                    info.key = key;
+                    if (settings.tileSize > 0) {
+                        assign_row_tile(info, geom, settings.tileSize);
+                    }
+                    out.rowInfo.push_back(info);
+                }
+            }
+        }
+    }
+    if (stats) {
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - scanStart).count();
+        (*stats)[Stage::Scan] += std::max(0.0, elapsed - (inner_seconds() - innerStart));
+    }
+
+    if (edges && edges->edges() > 0) {
+        logs[group.members.front()] << "  - 共享边简化: " << edges->edges() << " 条边，被要素引用 " << edges->uses()
+                                    << " 次；" << edges->adjusted() << " 条边简化后相交，已降低容差或保留原样"
+                                    << std::endl;
+    }
+
+    for (std::size_t r : group.members) {
+        if (!direct) {
+            for (CellResult& part : parts[r]) {
+                append_part(results[r], part);
+            }
+        }
+        rules[r]->log_summary(found[r], logs[r]);
+        if (found[r]) {
+            results[r].header = rules[r]->csv_header();
+        }
+    }
+}
+
+} // namespace
+
+CellResult extract_cell(const S57Cell& cell, const ExtractionRules& rules, const ExtractSettings& settings) {
+    std::vector<CellResult> results(1);
+    extract_cell(cell, {&rules}, {true}, settings, results);
+    return std::move(results.front());
+}
+
+void extract_cell(const S57Cell& cell, const std::vector<const ExtractionRules*>& rules,
+                  const std::vector<bool>& wanted, const ExtractSettings& settings,
+                  std::vector<CellResult>& results, CellStats* stats) {
+    std::vector<std::ostringstream> logs(rules.size());
+    const auto first = std::find(wanted.begin(), wanted.end(), true);
+    if (first == wanted.end()) {
+        return;
+    }
+    std::ostringstream& header = logs[first - wanted.begin()];
+    header << "正在处理: " << cell.path << std::endl;
+    if (!cell.updates.empty()) {
+        header << "  - 应用 " << cell.updates.size() << " 个更新文件" << std::endl;
+    }
+
+    // 图幅目录中有未过期的记录时，不含任何目标图层的规则不必打开图幅；
+    // 图幅范围在 bbox 之外时所有规则都不会有输出，同样不必打开
+    std::vector<bool> open = wanted;
+    CellCatalog::Entry known;
+    CellCatalog* catalog = settings.catalog;
+    if (catalog && catalog->lookup(cell, known)) {
+        catalog = nullptr;
+        if (settings.bbox && known.hasExtent &&
+            !settings.bbox->intersects(known.minX, known.minY, known.maxX, known.maxY)) {
+            open.assign(open.size(), false);
+            header << "  - 图幅范围在 --bbox 之外，未打开图幅" << std::endl;
+        } else {
+            std::vector<std::size_t> absent;
+            for (std::size_t r = 0; r < rules.size(); ++r) {
+                const std::vector<std::string>& layers = rules[r]->layers();
+                if (wanted[r] && std::none_of(layers.begin(), layers.end(),
+                                              [&](const std::string& layer) { return known.has_layer(layer); })) {
+                    open[r] = false;
+                    absent.push_back(r);
+                }
+            }
+            if (std::find(open.begin(), open.end(), true) == open.end()) {
+                header << "  - 图幅目录: 不含目标图层，未打开图幅" << std::endl;
+            }
+            for (std::size_t r : absent) {
+                rules[r]->log_summary(false, logs[r]);
+            }
+        }
+        if (settings.unopened && std::find(open.begin(), open.end(), true) == open.end()) {
+            ++*settings.unopened;
+        }
+    }
+
+    std::unique_ptr<CellGeometryCache> geometryCache;
+    if (!settings.geometryCacheDir.empty() && !settings.sharedEdges &&
+        std::find(open.begin(), open.end(), true) != open.end()) {
+        geometryCache = std::make_unique<CellGeometryCache>(settings.geometryCacheDir, cell);
+    }
+
+    for (OpenGroup& group : group_by_open_options(rules, open)) {
+        if (settings.sharedEdges) {
+            // 只增加图层和字段，不影响规则读取的要素，因此对所有规则都适用
+            const std::vector<std::string>& options = shared_edge_open_options();
+            group.options.insert(group.options.end(), options.begin(), options.end());
+        }
+        extract_group(cell, rules, group, settings, geometryCache.get(), catalog, results, logs, stats);
+    }
+
+    if (geometryCache && geometryCache->hits() + geometryCache->misses() > 0) {
+        header << "  - 几何缓存: 命中 " << geometryCache->hits() << " 个，重新计算 " << geometryCache->misses()
+               << " 个" << std::endl;
+        geometryCache->save();
+    }
+
+    for (std::size_t r = 0; r < rules.size(); ++r) {
+        if (wanted[r]) {
+            results[r].log = logs[r].str();
+        }
+    }
+}
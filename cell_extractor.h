@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cell_pipeline.h"
+#include "geometry_stage.h"
+#include "row_encoder.h"
+
+class CellCatalog;
+class ExtractionRules;
+class GDALDataset;
+struct CellStats;
+
+// 自定义 unique_ptr deleter 用于 GDALDataset
+void gdal_dataset_deleter(GDALDataset* ds);
+using GdalDatasetPtr = std::unique_ptr<GDALDataset, decltype(&gdal_dataset_deleter)>;
+
+/**
+ * @brief 以给定的打开选项用 S57 驱动打开图幅
+ * @return 打开失败时为空指针
+ */
+GdalDatasetPtr open_s57_cell(const S57Cell& cell, const std::vector<std::string>& openOptions);
+
+/**
+ * @brief 经纬度矩形范围 (--bbox)
+ */
+struct BoundingBox {
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+
+    bool intersects(double otherMinX, double otherMinY, double otherMaxX, double otherMaxY) const {
+        return otherMinX <= maxX && otherMaxX >= minX && otherMinY <= maxY && otherMaxY >= minY;
+    }
+    bool contains(double x, double y) const { return x >= minX && x <= maxX && y >= minY && y <= maxY; }
+};
+
+/**
+ * @brief 提取阶段的参数 (与提取规则无关的部分)
+ */
+struct ExtractSettings {
+    OutputFormat format = OutputFormat::Csv;
+    ToleranceTable tolerances;  // 按图幅等级选择的简化容差
+    double tileSize = 0;        // 切分输出的网格边长 (度)，0 表示不切分
+    std::string geometryCacheDir; // 几何缓存目录，为空表示不使用 (见 CellGeometryCache)
+    bool dedup = false;           // 为每行计算去重键 (见 RowDeduplicator)
+    CellCatalog* catalog = nullptr; // 图幅目录，为空表示不使用；不含目标图层的图幅不再打开
+    std::atomic<std::size_t>* unopened = nullptr; // 使用图幅目录时，统计因此未打开的图幅数
+    std::optional<BoundingBox> bbox; // 只输出与该范围相交的要素 (OGRLayer::SetSpatialFilterRect)
+    double grid = 0;                 // 简化后的坐标量化网格 (度)，0 表示不量化 (见 quantize_geometry)
+    bool sharedEdges = false;        // 线和面按共享边简化 (见 SharedEdgeSimplifier)，此时不使用几何缓存
+};
+
+/**
+ * @brief 按规则提取单个图幅，由工作线程调用
+ *
+ * 逐个要素读取目标图层，直接完成过滤、几何处理和输出行的生成，
+ * 不再经过 SQLite 方言的 UNION ALL 查询和 GDALVectorTranslate。
+ */
+CellResult extract_cell(const S57Cell& cell, const ExtractionRules& rules, const ExtractSettings& settings);
+
+/**
+ * @brief 一次打开图幅，同时按多组规则提取
+ *
+ * 打开选项相容的规则 (见 ExtractionRules::tolerates_open_option) 共用一个
+ * GDALDataset：所有规则的目标图层合并后每个只读一遍，同一要素被多组规则
+ * 选中时几何只简化和修复一次。每组规则的输出行顺序与单独提取时完全相同。
+ *
+ * 使用图幅目录时，目录记录中不含某组规则任何目标图层的图幅，该组规则的
+ * 结果与打开后未发现图层时相同；所有规则都如此时图幅不再打开。目录中记录的
+ * 图幅范围与 bbox 不相交时同样不打开。
+ *
+ * @param wanted 只提取 wanted[i] 为 true 的规则，结果写入 results[i]
+ * @param stats 不为空时累计各阶段耗时和计数 (见 CellStats)
+ */
+void extract_cell(const S57Cell& cell, const std::vector<const ExtractionRules*>& rules,
+                  const std::vector<bool>& wanted, const ExtractSettings& settings,
+                  std::vector<CellResult>& results, CellStats* stats = nullptr);
@@ -0,0 +1,248 @@
+#include "cell_pipeline.h"
+#include "cell_prefetch.h"
+#include "cell_stats.h"
+#include "incremental_cache.h"
+#include "output_sink.h"
+#include "row_dedup.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <numeric>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// 一个图幅的结果在等待写出期间占用的内存
+std::size_t pending_bytes(const std::vector<CellResult>& results) {
+    std::size_t bytes = 0;
+    for (const CellResult& result : results) {
+        bytes += result.log.size() + result.errors.size() + result.header.size() + result.rows.size() +
+                 result.rowInfo.size() * sizeof(RowInfo);
+    }
+    return bytes;
+}
+
+// 回收的缓冲超过这个容量时释放，避免个别大图幅的缓冲一直占着内存
+constexpr std::size_t kMaxSpareCapacity = 64u << 20;
+
+// 保留的回收缓冲合计最多占待写出上限的这个比例 (不限制待写出时按 kMaxSpareCapacity 计)
+constexpr std::size_t kSpareFraction = 4;
+
+// 一个图幅的结果缓冲保留的容量
+std::size_t spare_capacity(const std::vector<CellResult>& results) {
+    std::size_t bytes = 0;
+    for (const CellResult& result : results) {
+        bytes += result.log.capacity() + result.errors.capacity() + result.header.capacity() +
+                 result.rows.capacity() + result.rowInfo.capacity() * sizeof(RowInfo);
+    }
+    return bytes;
+}
+
+// 清空结果但保留字符串的容量，供下一个图幅复用
+void recycle(CellResult& result) {
+    for (std::string* buffer : {&result.log, &result.errors, &result.header, &result.rows}) {
+        if (buffer->capacity() > kMaxSpareCapacity) {
+            std::string().swap(*buffer);
+        } else {
+            buffer->clear();
+        }
+    }
+    if (result.rowInfo.capacity() * sizeof(RowInfo) > kMaxSpareCapacity) {
+        std::vector<RowInfo>().swap(result.rowInfo);
+    } else {
+        result.rowInfo.clear();
+    }
+    result.rowCount = 0;
+}
+
+} // namespace
+
+bool run_cell_pipeline(const std::vector<S57Cell>& cells, unsigned jobs,
+                       const CellProcessor& process, const std::vector<PipelineOutput>& outputs,
+                       std::size_t maxPendingBytes, std::vector<CellStats>* stats,
+                       CellPrefetcher* prefetcher) {
+    if (jobs == 0) {
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    jobs = static_cast<unsigned>(std::min<std::size_t>(jobs, std::max<std::size_t>(cells.size(), 1)));
+    if (stats) {
+        stats->assign(cells.size(), CellStats());
+    }
+
+    std::mutex mutex;
+    std::condition_variable ready; // 有新结果完成
+    std::condition_variable space; // 待写出的结果减少
+    std::map<std::size_t, std::vector<CellResult>> finished; // 已完成但尚未写出的图幅
+    std::size_t finishedBytes = 0;
+    std::size_t nextWrite = 0; // 写出线程正在等待的图幅
+    // 写出后回收的结果缓冲：工作线程复用其中字符串的容量逐行追加，不必每个图幅
+    // 重新从堆上分配、按倍数扩容，也避免大块内存在工作线程分配、在写出线程释放
+    // 这些缓冲不计入 finishedBytes，合计容量另外限制在 maxSpareBytes 以内
+    std::vector<std::vector<CellResult>> spare;
+    std::size_t spareBytes = 0;
+    const std::size_t maxSpareBytes = maxPendingBytes ? maxPendingBytes / kSpareFraction : kMaxSpareCapacity;
+
+    // 按文件大小从大到小分派图幅 (最长处理时间优先)，避免最后只剩一个线程处理大图幅
+    std::vector<std::size_t> order(cells.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) { return cells[a].bytes > cells[b].bytes; });
+    if (prefetcher) {
+        prefetcher->start(order);
+    }
+    std::vector<bool> claimed(cells.size(), false);
+    std::size_t nextOrder = 0; // order 中第一个可能未被领取的位置
+
+    // 领取下一个图幅 (持有 mutex 时调用)：待写出的结果超限时只能领取写出线程正在等待的图幅
+    auto claim = [&](std::unique_lock<std::mutex>& lock, std::size_t& i) {
+        space.wait(lock, [&] {
+            while (nextOrder < order.size() && claimed[order[nextOrder]]) {
+                ++nextOrder;
+            }
+            const bool headFree = nextWrite < cells.size() && !claimed[nextWrite];
+            return nextOrder == order.size() || maxPendingBytes == 0 || finishedBytes < maxPendingBytes || headFree;
+        });
+        if (nextOrder == order.size()) {
+            return false;
+        }
+        i = (maxPendingBytes == 0 || finishedBytes < maxPendingBytes) ? order[nextOrder] : nextWrite;
+        claimed[i] = true;
+        return true;
+    };
+
+    auto worker = [&]() {
+        for (;;) {
+            std::size_t i = 0;
+            std::vector<CellResult> results;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!claim(lock, i)) {
+                    return;
+                }
+                if (!spare.empty()) {
+                    results = std::move(spare.back());
+                    spare.pop_back();
+                    spareBytes -= spare_capacity(results);
+                }
+            }
+            results.resize(outputs.size());
+
+            CellStats* cellStats = stats ? &(*stats)[i] : nullptr;
+            try {
+                std::vector<bool> wanted(outputs.size(), true);
+                bool any = false;
+                for (std::size_t o = 0; o < outputs.size(); ++o) {
+                    if (outputs[o].cache && outputs[o].cache->lookup(i, cells[i], results[o])) {
+                        wanted[o] = false;
+                        if (cellStats) {
+                            ++cellStats->cachedOutputs;
+                        }
+                    }
+                    any = any || wanted[o];
+                }
+                // 所有输出都命中缓存时同样要领取，已预读的数据随即释放
+                PrefetchedCell prefetched = prefetcher ? prefetcher->acquire(i) : PrefetchedCell();
+                if (any) {
+                    if (prefetched.path().empty()) {
+                        process(cells[i], i, wanted, results, cellStats);
+                    } else {
+                        S57Cell cell = cells[i];
+                        cell.openPath = prefetched.path();
+                        process(cell, i, wanted, results, cellStats);
+                    }
+
+                    const bool failed = std::any_of(results.begin(), results.end(),
+                                                    [](const CellResult& r) { return !r.errors.empty(); });
+                    for (std::size_t o = 0; o < outputs.size() && !failed; ++o) {
+                        if (wanted[o] && outputs[o].cache) {
+                            outputs[o].cache->store(i, cells[i], results[o]);
+                        }
+                    }
+                }
+            } catch (const std::exception& e) {
+                results.assign(outputs.size(), CellResult());
+                if (!results.empty()) {
+                    results[0].errors = "错误：处理文件 " + cells[i].path + " 时发生异常: " + e.what() + "\n";
+                }
+            }
+            if (cellStats) {
+                cellStats->failed = std::any_of(results.begin(), results.end(),
+                                                [](const CellResult& r) { return !r.errors.empty(); });
+            }
+            const std::size_t bytes = pending_bytes(results);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.emplace(i, std::move(results));
+                finishedBytes += bytes;
+            }
+            ready.notify_one();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < jobs; ++t) {
+        workers.emplace_back(worker);
+    }
+
+    // 当前线程是唯一的写出线程：严格按图幅序号写出，保证输出与串行处理一致
+    std::vector<bool> ok(outputs.size(), true);
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        std::vector<CellResult> results;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (nextWrite != i) {
+                nextWrite = i;
+                space.notify_all(); // 让等待中的图幅 i 开始
+            }
+            ready.wait(lock, [&] { return finished.count(i) != 0; });
+            auto it = finished.find(i);
+            results = std::move(it->second);
+            finished.erase(it);
+            finishedBytes -= pending_bytes(results);
+        }
+        space.notify_all();
+
+        CellStats* cellStats = stats ? &(*stats)[i] : nullptr;
+        for (std::size_t o = 0; o < outputs.size(); ++o) {
+            std::cout << results[o].log;
+            std::cerr << results[o].errors;
+
+            StageTimer timer(cellStats, Stage::Write);
+            // 出错后继续消费剩余结果，让工作线程正常结束
+            try {
+                if (outputs[o].dedup) {
+                    outputs[o].dedup->filter(results[o]);
+                }
+                if (cellStats) {
+                    cellStats->bytes += results[o].rows.size();
+                }
+                if (ok[o] && !outputs[o].sink->write(results[o])) {
+                    ok[o] = false;
+                }
+            } catch (const std::exception& e) {
+                if (ok[o]) {
+                    std::cerr << "错误：写出文件 " << cells[i].path << " 的结果时发生异常: " << e.what() << std::endl;
+                }
+                ok[o] = false;
+            }
+        }
+
+        for (CellResult& result : results) {
+            recycle(result);
+        }
+        const std::size_t capacity = spare_capacity(results);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (spare.size() < jobs && spareBytes + capacity <= maxSpareBytes) {
+            spare.push_back(std::move(results));
+            spareBytes += capacity;
+        }
+    }
+
+    for (auto& t : workers) {
+        t.join();
+    }
+    return std::all_of(ok.begin(), ok.end(), [](bool b) { return b; });
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cell_scanner.h"
+
+struct CellStats;
+class CellPrefetcher;
+class IncrementalCache;
+class OutputSink;
+class RowDeduplicator;
+
+/**
+ * @brief 一行输出数据的附加信息，供写出线程切分或去重使用
+ */
+struct RowInfo {
+    static constexpr std::int32_t kEmpty = INT32_MIN; // 几何为空 (无外包矩形) 的行
+
+    std::size_t size = 0;         // 该行在 CellResult::rows 中的字节数 (含换行符)
+    std::uint64_t key = 0;        // 去重键 (见 RowEncoder)，不去重时为 0
+    std::int32_t column = kEmpty; // 网格列号，从 -180° 起算；不切分时为 kEmpty
+    std::int32_t row = kEmpty;    // 网格行号，从 -90° 起算
+    double minX = 0, minY = 0, maxX = 0, maxY = 0; // 几何外包矩形
+};
+
+/**
+ * @brief 单个 S57 图幅 (.000) 的处理结果
+ *
+ * 由工作线程生成，交给唯一的写出线程按图幅顺序合并到输出 CSV 中。
+ * 日志也缓存在这里，由写出线程统一打印，避免多线程输出交错。
+ */
+struct CellResult {
+    std::string log;     // 标准输出日志
+    std::string errors;  // 标准错误日志
+    std::string header;  // CSV 表头行 (含换行符)，为空表示该图幅没有输出
+    std::string rows;    // CSV 数据行 (含换行符)
+    std::size_t rowCount = 0; // rows 中的行数 (二进制格式的行记录不以换行符分隔，需要单独计数)
+    std::vector<RowInfo> rowInfo; // 切分或去重时 rows 中每一行的附加信息，依次对应；否则为空
+};
+
+/**
+ * @brief 处理单个图幅的回调
+ *
+ * 为 wanted[i] 为 true 的每个输出生成 results[i] (results 已按输出数分配好)；
+ * 其余输出的结果已由增量缓存给出，不应改动。results 中的字段都是空的，但可能
+ * 保留着之前图幅的容量，直接追加即可复用。
+ *
+ * @param cell 图幅
+ * @param index 图幅在扫描结果中的序号
+ * @param stats 该图幅的统计，不需要统计时为空
+ */
+using CellProcessor = std::function<void(const S57Cell& cell, std::size_t index, const std::vector<bool>& wanted,
+                                         std::vector<CellResult>& results, CellStats* stats)>;
+
+/**
+ * @brief 流水线的一个输出：输出端及其可选的增量缓存
+ */
+struct PipelineOutput {
+    OutputSink* sink = nullptr;
+    IncrementalCache* cache = nullptr; // 为空时该输出总是重新提取
+    RowDeduplicator* dedup = nullptr;  // 为空时不去重；否则写出前先丢弃重复的行
+};
+
+/**
+ * @brief 使用 jobs 个工作线程并行处理图幅，当前线程作为唯一的写出线程
+ *
+ * 每个工作线程打开自己的 GDALDataset，一次处理同时生成所有输出的结果；
+ * 写出线程按图幅序号顺序把每个输出的结果交给对应的 sink，因此输出与串行
+ * 处理完全一致，与 jobs 无关。sink 由调用方创建并在返回后关闭。
+ *
+ * 带缓存的输出先查缓存，只有未命中的输出才交给 process 重新提取；
+ * 所有输出都命中时不再打开图幅。任一输出出错的图幅不写入缓存。
+ *
+ * 图幅按文件大小从大到小分派给空闲的工作线程，大图幅最先开始，运行末尾
+ * 不会只剩一个线程处理大图幅；写出顺序不受影响。
+ *
+ * 已完成但还轮不到写出的结果按字节数计量：超过 maxPendingBytes 时工作线程
+ * 只能开始写出线程正在等待的那个图幅，其余图幅等写出线程赶上来再开始，
+ * 因此不会死锁；峰值内存约为 maxPendingBytes 加上 jobs 个正在处理的图幅，
+ * 与图幅总数无关。写出后留作复用的结果缓冲合计不超过 maxPendingBytes 的四分之一。
+ *
+ * @param maxPendingBytes 待写出结果的字节上限，0 表示不限制
+ * @param stats 不为空时调整为与 cells 一一对应，并记录每个图幅的统计 (见 CellStats)
+ * @param prefetcher 不为空时按分派顺序预读图幅，process 收到的图幅从内存打开
+ *                   (S57Cell::openPath)；所有输出都命中缓存的图幅读入后直接释放
+ * @return false 如果任一 sink 写入失败
+ */
+bool run_cell_pipeline(const std::vector<S57Cell>& cells, unsigned jobs,
+                       const CellProcessor& process, const std::vector<PipelineOutput>& outputs,
+                       std::size_t maxPendingBytes = 0, std::vector<CellStats>* stats = nullptr,
+                       CellPrefetcher* prefetcher = nullptr);
@@ -0,0 +1,172 @@
+#include "cell_prefetch.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <boost/filesystem.hpp>
+
+#include "cpl_vsi.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+std::atomic<std::size_t> g_instances{0}; // 为每个预读器分配不同的 /vsimem/ 目录
+
+// 读入一个文件并登记为 /vsimem/ 文件，内存由 VSI 接管，VSIUnlink 时释放
+// (源文件同样通过 VSI 读取，压缩包中的图幅在这里一次解压完)
+bool load_file(const std::string& path, const std::string& memPath) {
+    VSIStatBufL stat;
+    if (VSIStatL(path.c_str(), &stat) != 0) {
+        return false;
+    }
+    const std::size_t size = static_cast<std::size_t>(stat.st_size);
+    VSILFILE* in = VSIFOpenL(path.c_str(), "rb");
+    if (!in) {
+        return false;
+    }
+    GByte* data = static_cast<GByte*>(VSIMalloc(size > 0 ? size : 1));
+    const bool ok = data && VSIFReadL(data, 1, size, in) == size;
+    VSIFCloseL(in);
+    if (!ok) {
+        VSIFree(data);
+        return false;
+    }
+    VSILFILE* file = VSIFileFromMemBuffer(memPath.c_str(), data, static_cast<vsi_l_offset>(size), TRUE);
+    if (!file) {
+        VSIFree(data);
+        return false;
+    }
+    VSIFCloseL(file); // 关闭句柄不会删除内存文件
+    return true;
+}
+
+} // namespace
+
+PrefetchedCell::~PrefetchedCell() {
+    if (m_owner) {
+        m_owner->release(m_index);
+    }
+}
+
+PrefetchedCell::PrefetchedCell(PrefetchedCell&& other) noexcept
+    : m_owner(other.m_owner), m_index(other.m_index), m_path(std::move(other.m_path)) {
+    other.m_owner = nullptr;
+}
+
+PrefetchedCell& PrefetchedCell::operator=(PrefetchedCell&& other) noexcept {
+    if (this != &other) {
+        if (m_owner) {
+            m_owner->release(m_index);
+        }
+        m_owner = other.m_owner;
+        m_index = other.m_index;
+        m_path = std::move(other.m_path);
+        other.m_owner = nullptr;
+    }
+    return *this;
+}
+
+CellPrefetcher::CellPrefetcher(const std::vector<S57Cell>& cells, std::size_t depth)
+    : m_cells(cells), m_depth(std::max<std::size_t>(depth, 1)),
+      m_prefix("/vsimem/s57prefetch/" + std::to_string(g_instances++) + "/"), m_slots(cells.size()) {}
+
+CellPrefetcher::~CellPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_space.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    for (Slot& slot : m_slots) {
+        for (const std::string& file : slot.files) {
+            VSIUnlink(file.c_str());
+        }
+    }
+}
+
+void CellPrefetcher::start(std::vector<std::size_t> order) {
+    m_order = std::move(order);
+    m_thread = std::thread(&CellPrefetcher::run, this);
+}
+
+void CellPrefetcher::run() {
+    for (std::size_t index : m_order) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_space.wait(lock, [&] { return m_stop || m_ahead < m_depth; });
+            if (m_stop) {
+                return;
+            }
+            if (m_slots[index].state != State::Pending) {
+                continue; // 已被工作线程直接打开
+            }
+            m_slots[index].state = State::Loading;
+            ++m_ahead;
+        }
+
+        std::vector<std::string> files = load(index);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_slots[index].files = std::move(files);
+            m_slots[index].state = State::Ready;
+        }
+        m_ready.notify_all();
+    }
+}
+
+std::vector<std::string> CellPrefetcher::load(std::size_t index) {
+    const S57Cell& cell = m_cells[index];
+    const std::string dir = m_prefix + std::to_string(index) + "/";
+
+    std::vector<std::string> files;
+    std::vector<std::string> sources{cell.path};
+    sources.insert(sources.end(), cell.updates.begin(), cell.updates.end());
+    for (const std::string& source : sources) {
+        const std::string memPath = dir + fs::path(source).filename().string();
+        if (!load_file(source, memPath)) {
+            break; // 读到的更新链不完整时驱动会少应用更新，改为直接打开原文件
+        }
+        files.push_back(memPath);
+    }
+    if (files.size() != sources.size()) {
+        for (const std::string& file : files) {
+            VSIUnlink(file.c_str());
+        }
+        files.clear();
+    }
+    return files;
+}
+
+PrefetchedCell CellPrefetcher::acquire(std::size_t index) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Slot& slot = m_slots[index];
+    if (slot.state == State::Pending) {
+        slot.state = State::Taken;
+        return PrefetchedCell();
+    }
+    m_ready.wait(lock, [&] { return slot.state != State::Loading; });
+    if (slot.state != State::Ready) {
+        return PrefetchedCell();
+    }
+    slot.state = State::Taken;
+    --m_ahead;
+    m_space.notify_one();
+    if (slot.files.empty()) {
+        return PrefetchedCell(); // 读取失败
+    }
+    return PrefetchedCell(this, index, slot.files.front());
+}
+
+void CellPrefetcher::release(std::size_t index) {
+    std::vector<std::string> files;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        files.swap(m_slots[index].files);
+    }
+    for (const std::string& file : files) {
+        VSIUnlink(file.c_str());
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cell_scanner.h"
+
+class CellPrefetcher;
+
+/**
+ * @brief 一个已预读到内存中的图幅，析构时释放其内存文件
+ */
+class PrefetchedCell {
+public:
+    PrefetchedCell() = default;
+    PrefetchedCell(CellPrefetcher* owner, std::size_t index, std::string path)
+        : m_owner(owner), m_index(index), m_path(std::move(path)) {}
+    ~PrefetchedCell();
+
+    PrefetchedCell(PrefetchedCell&& other) noexcept;
+    PrefetchedCell& operator=(PrefetchedCell&& other) noexcept;
+    PrefetchedCell(const PrefetchedCell&) = delete;
+    PrefetchedCell& operator=(const PrefetchedCell&) = delete;
+
+    /**
+     * @brief 基础文件在 /vsimem/ 中的路径；为空表示没有预读，应直接打开原文件
+     */
+    const std::string& path() const { return m_path; }
+
+private:
+    CellPrefetcher* m_owner = nullptr;
+    std::size_t m_index = 0;
+    std::string m_path;
+};
+
+/**
+ * @brief 图幅预读阶段：一个 I/O 线程按分派顺序提前把图幅读入内存
+ *
+ * 输入目录在慢速的网络盘或 WSL 挂载盘上时，驱动解析 ISO 8211 记录的大量小块
+ * 读取会让工作线程一直等待 I/O。预读线程用大块顺序读取把基础文件和更新文件
+ * 整个读入 /vsimem/ (每个图幅一个目录，文件名不变，驱动照常找到更新文件)，
+ * 工作线程从内存打开，读取与解析重叠进行。
+ *
+ * 最多提前读入 depth 个尚未开始处理的图幅，因此内存中同时最多有 depth 加上
+ * 工作线程数个图幅。工作线程领取到还没轮到预读的图幅 (例如写出线程在等待的
+ * 图幅插队) 时，该图幅不再预读，由工作线程直接打开原文件。
+ */
+class CellPrefetcher {
+public:
+    CellPrefetcher(const std::vector<S57Cell>& cells, std::size_t depth);
+    ~CellPrefetcher();
+
+    CellPrefetcher(const CellPrefetcher&) = delete;
+    CellPrefetcher& operator=(const CellPrefetcher&) = delete;
+
+    /**
+     * @brief 按 order 中的顺序 (图幅序号) 开始预读
+     */
+    void start(std::vector<std::size_t> order);
+
+    /**
+     * @brief 领取一个图幅：正在读取时等待读完；还没开始读取时不再预读，返回空路径
+     */
+    PrefetchedCell acquire(std::size_t index);
+
+private:
+    friend class PrefetchedCell;
+
+    enum class State { Pending, Loading, Ready, Taken };
+
+    struct Slot {
+        State state = State::Pending;
+        std::vector<std::string> files; // 已登记到 /vsimem/ 的文件，第一个为基础文件
+    };
+
+    void run();
+    std::vector<std::string> load(std::size_t index);
+    void release(std::size_t index);
+
+    const std::vector<S57Cell>& m_cells;
+    std::size_t m_depth;
+    std::string m_prefix; // 本实例的 /vsimem/ 目录；服务模式下同时运行的作业各有自己的预读器
+    std::vector<std::size_t> m_order;
+    std::vector<Slot> m_slots;
+    std::size_t m_ahead = 0; // 正在读取或已读入、尚未被领取的图幅数
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_ready; // 有图幅读完
+    std::condition_variable m_space; // 有预读的图幅被领取
+    std::thread m_thread;
+};
@@ -0,0 +1,195 @@
+#include "cell_scanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// 更新文件的扩展名是三位数字序号 (.001 - .999)
+int update_number(const std::string& path) {
+    const std::string ext = fs::path(path).extension().string();
+    if (ext.size() != 4 || !std::isdigit(static_cast<unsigned char>(ext[1])) ||
+        !std::isdigit(static_cast<unsigned char>(ext[2])) || !std::isdigit(static_cast<unsigned char>(ext[3]))) {
+        return -1;
+    }
+    return std::stoi(ext.substr(1));
+}
+
+// 可以直接读取成员的分发压缩包对应的 GDAL 虚拟文件系统前缀，其余文件返回空
+std::string archive_prefix(const fs::path& path) {
+    std::string name = path.filename().string();
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    auto ends_with = [&](const char* suffix) {
+        const std::size_t n = std::strlen(suffix);
+        return name.size() > n && name.compare(name.size() - n, n, suffix) == 0;
+    };
+    if (ends_with(".zip")) {
+        return "/vsizip/";
+    }
+    if (ends_with(".tar") || ends_with(".tgz") || ends_with(".tar.gz")) {
+        return "/vsitar/";
+    }
+    return "";
+}
+
+// 扫描到的文件：基础文件直接成为图幅，更新文件留待按序号查找
+struct ScanResult {
+    std::vector<S57Cell> cells;
+    std::map<std::string, std::uintmax_t> updates; // 所有更新文件及其大小
+};
+
+void add_file(ScanResult& scan, const std::string& path, std::uintmax_t bytes) {
+    const int number = update_number(path);
+    if (number == 0) {
+        scan.cells.push_back(S57Cell{path, {}, bytes, {}});
+    } else if (number > 0) {
+        scan.updates.emplace(path, bytes);
+    }
+}
+
+// 枚举压缩包中的成员，图幅路径形如 /vsizip/<压缩包>/<成员路径>，由驱动直接从压缩包中读取
+void scan_archive(ScanResult& scan, const std::string& root) {
+    char** members = VSIReadDirRecursive(root.c_str());
+    for (int i = 0; members && members[i]; ++i) {
+        const std::string path = root + "/" + members[i];
+        VSIStatBufL stat;
+        if (update_number(path) < 0 || VSIStatL(path.c_str(), &stat) != 0 || VSI_ISDIR(stat.st_mode)) {
+            continue;
+        }
+        add_file(scan, path, static_cast<std::uintmax_t>(stat.st_size));
+    }
+    CSLDestroy(members);
+}
+
+// 扫描一个目录项：压缩包枚举其成员，基础文件和更新文件直接加入
+void scan_entry(ScanResult& scan, const fs::directory_entry& entry) {
+    const std::string path = entry.path().string();
+    const std::string prefix = archive_prefix(entry.path());
+    if (!prefix.empty() && fs::is_regular_file(entry.status())) {
+        scan_archive(scan, prefix + path);
+        return;
+    }
+    if (update_number(path) < 0) {
+        return;
+    }
+    boost::system::error_code ec;
+    std::uintmax_t bytes = fs::file_size(entry.path(), ec);
+    if (ec) {
+        bytes = 0;
+    }
+    add_file(scan, path, bytes);
+}
+
+void scan_tree(ScanResult& scan, const fs::path& dir) {
+    for (const auto& entry : fs::recursive_directory_iterator(dir)) {
+        scan_entry(scan, entry);
+    }
+}
+
+void merge(ScanResult& into, ScanResult& from) {
+    into.cells.insert(into.cells.end(), std::make_move_iterator(from.cells.begin()),
+                      std::make_move_iterator(from.cells.end()));
+    into.updates.insert(from.updates.begin(), from.updates.end());
+}
+
+// 交换集通常按生产者或国家分成多个子目录，网络盘上逐个列目录的往返延迟
+// 远大于本地处理时间，因此各个子目录和压缩包由多个线程同时遍历
+constexpr unsigned kMaxScanThreads = 8;
+
+} // namespace
+
+std::vector<S57Cell> collect_s57_cells(const std::string& inputDir) {
+    ScanResult scan;
+    if (!archive_prefix(inputDir).empty() && fs::is_regular_file(inputDir)) {
+        scan_archive(scan, archive_prefix(inputDir) + inputDir); // 输入本身就是一个交换集压缩包
+    } else {
+        // 顶层的普通文件直接扫描，子目录和压缩包交给工作线程
+        std::vector<fs::directory_entry> branches;
+        for (const auto& entry : fs::directory_iterator(inputDir)) {
+            if (fs::is_directory(entry.symlink_status()) || // 与递归遍历一样不进入符号链接的目录
+                (!archive_prefix(entry.path()).empty() && fs::is_regular_file(entry.status()))) {
+                branches.push_back(entry);
+            } else {
+                scan_entry(scan, entry);
+            }
+        }
+
+        const unsigned threads = static_cast<unsigned>(std::min<std::size_t>(
+            branches.size(), std::min(kMaxScanThreads, std::max(1u, std::thread::hardware_concurrency()))));
+        std::mutex mutex;
+        std::size_t next = 0;
+        std::exception_ptr error;
+        auto worker = [&] {
+            ScanResult local;
+            try {
+                for (;;) {
+                    std::size_t b;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (next == branches.size() || error) {
+                            break;
+                        }
+                        b = next++;
+                    }
+                    if (fs::is_directory(branches[b].symlink_status())) {
+                        scan_tree(local, branches[b].path());
+                    } else {
+                        scan_entry(local, branches[b]);
+                    }
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            merge(scan, local);
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back(worker);
+        }
+        for (auto& t : workers) {
+            t.join();
+        }
+        if (error) {
+            std::rethrow_exception(error); // 与串行遍历一样由调用方报告文件系统错误
+        }
+    }
+    std::vector<S57Cell>& cells = scan.cells;
+    std::sort(cells.begin(), cells.end(), [](const S57Cell& a, const S57Cell& b) { return a.path < b.path; });
+
+    for (S57Cell& cell : cells) {
+        const std::string stem = cell.path.substr(0, cell.path.size() - 4); // 去掉 ".000"
+        for (int number = 1; number <= 999; ++number) {
+            char ext[8];
+            std::snprintf(ext, sizeof(ext), ".%03d", number);
+            auto it = scan.updates.find(stem + ext);
+            if (it == scan.updates.end()) {
+                break;
+            }
+            cell.updates.push_back(it->first);
+            cell.bytes += it->second;
+        }
+    }
+    return std::move(scan.cells);
+}
+
+char cell_level(const S57Cell& cell) {
+    const std::string filename = fs::path(cell.path).filename().string();
+    return filename.length() >= 3 ? filename[2] : '0';
+}
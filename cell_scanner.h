@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 一个图幅：基础文件 (.000) 及其更新文件链 (.001, .002, …)
+ *
+ * S57 驱动打开基础文件时会自动应用同目录下的更新文件 (UPDATES=APPLY)，
+ * 这里记录更新链是为了让增量缓存能发现更新文件的变化。
+ */
+struct S57Cell {
+    std::string path;
+    std::vector<std::string> updates; // 按序号排列，与驱动的查找规则一致：遇到缺号即停止
+    std::uintmax_t bytes = 0;         // 基础文件与更新文件的总大小，用于估计处理耗时
+    std::string openPath;             // 实际打开的路径 (例如预读到 /vsimem/ 中的副本)，为空时打开 path
+};
+
+/**
+ * @brief 递归收集输入目录下的所有 .000 文件及其更新文件，并按路径排序以保证输出顺序稳定
+ *
+ * 同时记录每个图幅的文件大小，供流水线安排处理顺序。输入目录下的各个子目录
+ * 和压缩包由多个线程并行遍历，结果与串行遍历相同。
+ *
+ * 目录中的 .zip、.tar、.tar.gz (.tgz) 交换集压缩包不需要解压：其中的图幅路径
+ * 为 /vsizip/ 或 /vsitar/ 虚拟路径，由 GDAL 直接从压缩包读取。inputDir 本身
+ * 也可以是一个压缩包。
+ */
+std::vector<S57Cell> collect_s57_cells(const std::string& inputDir);
+
+/**
+ * @brief 图幅的航行用途等级 (ENC 文件名的第 3 个字符，'1' 总图 - '6' 泊位图)
+ * @return 文件名过短时为 '0'
+ */
+char cell_level(const S57Cell& cell);
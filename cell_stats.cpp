@@ -0,0 +1,167 @@
+#include "cell_stats.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "csv_format.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+constexpr int kStageCount = static_cast<int>(Stage::Count);
+
+const char* const kCounterNames[] = {"features", "rows",            "vertices",       "bytes",
+                                     "valid",    "makevalid_calls", "cached_outputs", "failed"};
+constexpr int kCounterCount = sizeof(kCounterNames) / sizeof(kCounterNames[0]);
+
+void counters(const CellStats& stats, std::uint64_t (&values)[kCounterCount]) {
+    values[0] = stats.features;
+    values[1] = stats.rows;
+    values[2] = stats.vertices;
+    values[3] = stats.bytes;
+    values[4] = stats.valid;
+    values[5] = stats.makeValidCalls;
+    values[6] = stats.cachedOutputs;
+    values[7] = stats.failed ? 1 : 0;
+}
+
+CellStats total_of(const std::vector<CellStats>& stats) {
+    CellStats total;
+    for (const CellStats& cell : stats) {
+        for (int s = 0; s < kStageCount; ++s) {
+            total.seconds[s] += cell.seconds[s];
+        }
+        total.features += cell.features;
+        total.rows += cell.rows;
+        total.vertices += cell.vertices;
+        total.bytes += cell.bytes;
+        total.valid += cell.valid;
+        total.makeValidCalls += cell.makeValidCalls;
+        total.cachedOutputs += cell.cachedOutputs;
+        total.failed = total.failed || cell.failed;
+    }
+    return total;
+}
+
+void append_seconds(std::string& out, double seconds) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.6f", seconds);
+    out += buf;
+}
+
+void append_json_string(std::string& out, const std::string& value) {
+    out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void append_json_record(std::string& out, const std::string& path, const CellStats& stats) {
+    out += "{\"path\":";
+    append_json_string(out, path);
+    for (int s = 0; s < kStageCount; ++s) {
+        out += ",\"";
+        out += stage_name(static_cast<Stage>(s));
+        out += "\":";
+        append_seconds(out, stats.seconds[s]);
+    }
+    std::uint64_t values[kCounterCount];
+    counters(stats, values);
+    for (int c = 0; c < kCounterCount; ++c) {
+        out += ",\"";
+        out += kCounterNames[c];
+        out += "\":" + std::to_string(values[c]);
+    }
+    out += '}';
+}
+
+void append_csv_record(std::string& out, const std::string& path, const CellStats& stats) {
+    append_csv_string(out, path.c_str());
+    for (int s = 0; s < kStageCount; ++s) {
+        out += ',';
+        append_seconds(out, stats.seconds[s]);
+    }
+    std::uint64_t values[kCounterCount];
+    counters(stats, values);
+    for (int c = 0; c < kCounterCount; ++c) {
+        out += ',' + std::to_string(values[c]);
+    }
+    out += '\n';
+}
+
+} // namespace
+
+const char* stage_name(Stage stage) {
+    switch (stage) {
+    case Stage::Open:
+        return "open";
+    case Stage::Scan:
+        return "scan";
+    case Stage::Filter:
+        return "filter";
+    case Stage::Simplify:
+        return "simplify";
+    case Stage::Quantize:
+        return "quantize";
+    case Stage::Precheck:
+        return "precheck";
+    case Stage::MakeValid:
+        return "makevalid";
+    case Stage::Serialize:
+        return "serialize";
+    case Stage::Write:
+        return "write";
+    default:
+        return "";
+    }
+}
+
+bool write_stats_report(const std::string& path, const std::vector<S57Cell>& cells,
+                        const std::vector<CellStats>& stats, double wallSeconds) {
+    const CellStats total = total_of(stats);
+    std::string out;
+    if (fs::path(path).extension() == ".csv") {
+        out = "PATH";
+        for (int s = 0; s < kStageCount; ++s) {
+            out += ',';
+            out += stage_name(static_cast<Stage>(s));
+        }
+        for (const char* name : kCounterNames) {
+            out += ',';
+            out += name;
+        }
+        out += '\n';
+        for (std::size_t i = 0; i < cells.size(); ++i) {
+            append_csv_record(out, cells[i].path, stats[i]);
+        }
+        append_csv_record(out, "*", total);
+    } else {
+        out = "{\"wall_seconds\":";
+        append_seconds(out, wallSeconds);
+        out += ",\"total\":";
+        append_json_record(out, "*", total);
+        out += ",\"cells\":[";
+        for (std::size_t i = 0; i < cells.size(); ++i) {
+            out += i ? ",\n" : "\n";
+            append_json_record(out, cells[i].path, stats[i]);
+        }
+        out += "\n]}\n";
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cell_scanner.h"
+
+/**
+ * @brief 单个图幅处理过程中计时的阶段
+ */
+enum class Stage {
+    Open,      // 打开图幅 (含驱动读取 ISO 8211 记录、应用更新文件)
+    Scan,      // 遍历图层读取要素 (驱动组装要素及其几何)
+    Filter,    // 属性过滤
+    Simplify,  // SimplifyPreserveTopology
+    Quantize,  // 坐标量化和去除重复顶点 (--quantize)
+    Precheck,  // MakeValid 之前的快速有效性检查
+    MakeValid, // MakeValid
+    Serialize, // 生成 WKT/CSV 行或二进制行记录
+    Write,     // 写出线程把结果交给输出端 (含去重；流式 ZIP 时含压缩)
+    Count
+};
+
+/**
+ * @brief 阶段名，用作报告中的列名
+ */
+const char* stage_name(Stage stage);
+
+/**
+ * @brief 单个图幅的耗时与计数，用于 --stats 报告
+ *
+ * 每个图幅的统计只由处理它的工作线程和写出线程依次修改，不需要加锁。
+ * 多个输出共用的工作 (打开、读取、几何处理) 只计一次。
+ */
+struct CellStats {
+    double seconds[static_cast<int>(Stage::Count)] = {};
+    std::uint64_t features = 0; // 读取的要素数
+    std::uint64_t rows = 0;     // 提取出的行数 (所有输出之和，去重前)
+    std::uint64_t vertices = 0; // 输出几何的顶点数
+    std::uint64_t bytes = 0;    // 交给输出端的字节数 (去重后)
+    std::uint64_t valid = 0;    // 通过快速检查、不需要 MakeValid 的几何数
+    std::uint64_t makeValidCalls = 0; // 未通过快速检查、交给 MakeValid 的几何数 (检查是保守的，不代表都需要修复)
+    unsigned cachedOutputs = 0; // 由增量缓存给出的输出数
+    bool failed = false;
+
+    double& operator[](Stage stage) { return seconds[static_cast<int>(stage)]; }
+    double operator[](Stage stage) const { return seconds[static_cast<int>(stage)]; }
+};
+
+/**
+ * @brief 在作用域内为一个阶段计时；stats 为空时不读取时钟
+ */
+class StageTimer {
+public:
+    StageTimer(CellStats* stats, Stage stage) : m_stats(stats), m_stage(stage) {
+        if (m_stats) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer() {
+        if (m_stats) {
+            (*m_stats)[m_stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        }
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    CellStats* m_stats;
+    Stage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * @brief 写出 --stats 报告：每个图幅一条记录，外加所有图幅的合计
+ *
+ * 文件后缀为 .csv 时写 CSV (每个图幅一行，最后一行的 PATH 为 "*" 表示合计)，
+ * 否则写 JSON。耗时以秒为单位。
+ *
+ * @param stats 与 cells 一一对应
+ * @return false 如果文件无法写入
+ */
+bool write_stats_report(const std::string& path, const std::vector<S57Cell>& cells,
+                        const std::vector<CellStats>& stats, double wallSeconds);
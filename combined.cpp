@@ -0,0 +1,40 @@
+#include <iostream>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "export_app.h"
+#include "export_service.h"
+#include "extraction_rules.h"
+
+namespace po = boost::program_options;
+
+
+int main(int argc, char* argv[]) {
+    // --- 1. 使用 Boost::program_options 解析命令行参数 ---
+    // 同时完成 export_depth 和 export_nobjnm 的导出，每个图幅只打开、解析一次
+    po::options_description desc("S57 Combined Processor Options");
+    add_export_options(desc, "");
+    desc.add_options()
+        ("depth-name", po::value<std::string>()->default_value("depth"), "水深输出的文件名 (不含后缀)")
+        ("nobjnm-name", po::value<std::string>()->default_value("nobjnm"), "名称筛选输出的文件名 (不含后缀)");
+    FieldFilterRules::add_options(desc);
+
+    // 单次导出，或者以 --serve 常驻并逐个执行作业
+    return run_export_tool(argc, argv, desc, [](const po::variables_map& vm, const ExportOptions& options) {
+        const std::string depthName = vm["depth-name"].as<std::string>();
+        const std::string nobjnmName = vm["nobjnm-name"].as<std::string>();
+        if (depthName == nobjnmName) {
+            std::cerr << "错误: --depth-name 和 --nobjnm-name 不能相同" << std::endl;
+            return 1;
+        }
+
+        // --- 2. 两组提取规则，与两个单独的工具完全一致 ---
+        const DepthRules depthRules(DepthRules::default_depth_fields(), "LNDARE");
+        const FieldFilterRules nobjnmRules = FieldFilterRules::from_options(vm);
+
+        // --- 3. 一次遍历图幅，同时写出两个输出 ---
+        return run_export(options,
+                          {ExportTarget{depthName, &depthRules}, ExportTarget{nobjnmName, &nobjnmRules}});
+    });
+}
@@ -0,0 +1,160 @@
+#include "coord_kernel.h"
+
+#include <cmath>
+#include <vector>
+
+#include "ogr_geometry.h"
+
+// x86-64 上 AVX2 实现总是编译进来：指定了 -mavx2 (或 /arch:AVX2) 时直接使用，
+// 否则 GCC/Clang 用函数级的 target 属性单独编译，运行时按 CPU 支持情况选择
+#if defined(__AVX2__)
+#define S57_HAS_AVX2 1
+#define S57_TARGET_AVX2
+#elif (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define S57_HAS_AVX2 1
+#define S57_AVX2_DISPATCH 1
+#define S57_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(S57_HAS_AVX2)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+#if defined(S57_HAS_AVX2)
+// 处理能被 4 整除的部分，返回处理过的个数
+S57_TARGET_AVX2 std::size_t quantize_values_avx2(double* values, std::size_t n, double scale) {
+    std::size_t i = 0;
+    const __m256d vscale = _mm256_set1_pd(scale);
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_mul_pd(_mm256_loadu_pd(values + i), vscale);
+        v = _mm256_round_pd(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_pd(values + i, _mm256_div_pd(v, vscale));
+    }
+    return i;
+}
+#endif
+
+bool use_avx2() {
+#if defined(S57_AVX2_DISPATCH)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#elif defined(S57_HAS_AVX2)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 量化连续存放的 n 个 double，SIMD 只处理能整除的部分，剩余的交给标量循环
+void quantize_values(double* values, std::size_t n, double scale) {
+    std::size_t i = 0;
+#if defined(S57_HAS_AVX2)
+    if (use_avx2()) {
+        i = quantize_values_avx2(values, n, scale);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t vscale = vdupq_n_f64(scale);
+    for (; i + 2 <= n; i += 2) {
+        const float64x2_t v = vrndnq_f64(vmulq_f64(vld1q_f64(values + i), vscale));
+        vst1q_f64(values + i, vdivq_f64(v, vscale));
+    }
+#endif
+    for (; i < n; ++i) {
+        values[i] = std::nearbyint(values[i] * scale) / scale; // 默认舍入模式即取最近偶数
+    }
+}
+
+void quantize_curve(OGRSimpleCurve& curve, double grid, std::size_t minPoints) {
+    const int count = curve.getNumPoints();
+    if (count == 0) {
+        return;
+    }
+    // 每个工作线程复用自己的缓冲，避免每条线都分配
+    thread_local std::vector<OGRRawPoint> points;
+    thread_local std::vector<double> z;
+    const bool hasZ = curve.getCoordinateDimension() > 2;
+    points.resize(count);
+    z.resize(hasZ ? count : 0);
+    curve.getPoints(points.data(), hasZ ? z.data() : nullptr);
+
+    static_assert(sizeof(OGRRawPoint) == 2 * sizeof(double), "OGRRawPoint 应为连续的 x, y");
+    double* xy = reinterpret_cast<double*>(points.data());
+    const std::size_t kept = quantize_points(xy, hasZ ? z.data() : nullptr, static_cast<std::size_t>(count), grid);
+    if (kept == static_cast<std::size_t>(count)) {
+        curve.setPoints(count, points.data(), hasZ ? z.data() : nullptr);
+    } else if (kept >= minPoints) {
+        curve.setPoints(static_cast<int>(kept), points.data(), hasZ ? z.data() : nullptr);
+    } else {
+        // 退化的线或环：重新读取，只量化不去重
+        curve.getPoints(points.data(), hasZ ? z.data() : nullptr);
+        quantize_values(xy, 2 * static_cast<std::size_t>(count), 1.0 / grid);
+        curve.setPoints(count, points.data(), hasZ ? z.data() : nullptr);
+    }
+}
+
+} // namespace
+
+std::size_t quantize_points(double* xy, double* z, std::size_t count, double grid) {
+    if (count == 0) {
+        return 0;
+    }
+    quantize_values(xy, 2 * count, 1.0 / grid);
+
+    std::size_t kept = 1;
+    for (std::size_t i = 1; i < count; ++i) {
+        if (xy[2 * i] == xy[2 * kept - 2] && xy[2 * i + 1] == xy[2 * kept - 1]) {
+            continue;
+        }
+        xy[2 * kept] = xy[2 * i];
+        xy[2 * kept + 1] = xy[2 * i + 1];
+        if (z) {
+            z[kept] = z[i];
+        }
+        ++kept;
+    }
+    return kept;
+}
+
+void quantize_geometry(OGRGeometry& geom, double grid) {
+    switch (wkbFlatten(geom.getGeometryType())) {
+    case wkbLineString:
+        quantize_curve(*geom.toSimpleCurve(), grid, 2);
+        break;
+    case wkbLinearRing:
+        quantize_curve(*geom.toSimpleCurve(), grid, 4);
+        break;
+    case wkbPolygon: {
+        OGRPolygon* poPoly = geom.toPolygon();
+        if (OGRLinearRing* poRing = poPoly->getExteriorRing()) {
+            quantize_curve(*poRing, grid, 4);
+        }
+        for (int i = 0; i < poPoly->getNumInteriorRings(); ++i) {
+            quantize_curve(*poPoly->getInteriorRing(i), grid, 4);
+        }
+        break;
+    }
+    case wkbMultiLineString:
+    case wkbMultiPolygon:
+    case wkbGeometryCollection: {
+        OGRGeometryCollection* poColl = geom.toGeometryCollection();
+        for (int i = 0; i < poColl->getNumGeometries(); ++i) {
+            quantize_geometry(*poColl->getGeometryRef(i), grid);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+const char* coord_kernel_name() {
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    return "neon";
+#else
+    return use_avx2() ? "avx2" : "scalar";
+#endif
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+class OGRGeometry;
+
+/**
+ * @brief 输出坐标的量化网格 (度)，与 OGR_WKT_PRECISION=8 输出的小数位数一致
+ */
+constexpr double kWktGrid = 1e-8;
+
+/**
+ * @brief 把交错存放的坐标 (x0, y0, x1, y1, ...) 原地量化到 grid 的整数倍，
+ *        并去掉量化后连续重复的顶点
+ *
+ * 量化为 round(v / grid) * grid，按 (v * (1 / grid)) 取最近偶数再除以 (1 / grid)
+ * 计算，AVX2、NEON 和标量实现的结果逐位相同。
+ *
+ * @param xy 2 * count 个坐标
+ * @param z 与顶点一一对应的 Z 值，可以为空；随去重同步压缩，重复顶点保留第一个的 Z
+ * @param count 顶点数
+ * @return 去重后的顶点数
+ */
+std::size_t quantize_points(double* xy, double* z, std::size_t count, double grid);
+
+/**
+ * @brief 对几何中所有线和环的顶点执行 quantize_points
+ *
+ * 去重后线少于 2 个顶点、环少于 4 个顶点时只量化不去重，保持 GEOS 可以
+ * 构造的几何，交给 MakeValid 处理退化的情况。点不处理：单个点量化前后
+ * 输出的文本相同。
+ */
+void quantize_geometry(OGRGeometry& geom, double grid);
+
+/**
+ * @brief 实际使用的量化实现："avx2" (x86-64 上 CPU 支持时运行时选择)、"neon" 或 "scalar"
+ */
+const char* coord_kernel_name();
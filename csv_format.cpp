@@ -0,0 +1,292 @@
+#include "csv_format.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "ogr_geometry.h"
+
+namespace {
+
+// 判断字符串是否会被 CSV 读取端识别为数字 (整数或浮点数)
+bool looks_numeric(const char* value) {
+    if (*value == '\0') {
+        return false;
+    }
+    char* end = nullptr;
+    std::strtod(value, &end);
+    return end != value && *end == '\0';
+}
+
+bool needs_quoting(const char* value) {
+    const std::size_t len = std::strlen(value);
+    if (len == 0) {
+        return false;
+    }
+    if (value[0] == ' ' || value[len - 1] == ' ') {
+        return true;
+    }
+    return std::strpbrk(value, ",\"\r\n") != nullptr || looks_numeric(value);
+}
+
+// 与 OGR_WKT_PRECISION 保持一致的小数位数
+constexpr int kWktPrecision = 8;
+
+// 最大的 double 定点表示所需的长度：符号、DBL_MAX_10_EXP + 1 位整数、小数点、小数位和结尾的 '\0'
+constexpr std::size_t kFixedMaxSize = DBL_MAX_10_EXP + kWktPrecision + 4;
+
+// 写入 (可能带 ".0" 的) 定点小数；intPair 为 true 时 x、y 均为整数，不追加 ".0"
+// @return false 如果 value 不是有限值 (此时 out 不变)，由调用方改用 OGR 的格式
+bool append_fixed(std::string& out, double value, bool intPair) {
+    if (!std::isfinite(value)) {
+        return false;
+    }
+    char small[64];
+    char large[kFixedMaxSize];
+    char* buf = small;
+    const auto res = std::to_chars(small, small + sizeof(small), value, std::chars_format::fixed, kWktPrecision);
+    char* end = res.ptr;
+    if (res.ec != std::errc()) {
+        // |value| 约 1e55 以上时定点表示超出常用的缓冲区
+        buf = large;
+        const int len = std::snprintf(large, sizeof(large), "%.*f", kWktPrecision, value);
+        if (len <= 0 || static_cast<std::size_t>(len) >= sizeof(large)) {
+            return false;
+        }
+        end = large + len;
+    }
+
+    // 去掉末尾的 0："12.50000000" -> "12.5"，"12.00000000" -> "12" 或 "12.0"
+    while (end[-1] == '0') {
+        --end;
+    }
+    if (end[-1] == '.') {
+        end = intPair ? end - 1 : end + 1;
+    }
+
+    // 舍入后为 0 的负数不输出符号，例如 -0.000000001
+    char* begin = buf;
+    if (buf[0] == '-' && std::all_of(buf + 1, end, [](char c) { return c == '0' || c == '.'; })) {
+        ++begin;
+    }
+    out.append(begin, end);
+    return true;
+}
+
+bool is_int(double value) {
+    return value >= static_cast<double>(INT_MIN) && value <= static_cast<double>(INT_MAX) &&
+           value == static_cast<double>(static_cast<int>(value));
+}
+
+// 以下函数返回 false 时 out 中可能留有部分输出，由 append_wkt 统一回滚
+bool append_xy(std::string& out, double x, double y) {
+    const bool intPair = is_int(x) && is_int(y);
+    if (!append_fixed(out, x, intPair)) {
+        return false;
+    }
+    out += ' ';
+    return append_fixed(out, y, intPair);
+}
+
+bool append_points(std::string& out, const OGRSimpleCurve& curve) {
+    out += '(';
+    const int n = curve.getNumPoints();
+    for (int i = 0; i < n; ++i) {
+        if (i) out += ',';
+        if (!append_xy(out, curve.getX(i), curve.getY(i))) {
+            return false;
+        }
+    }
+    out += ')';
+    return true;
+}
+
+bool append_rings(std::string& out, const OGRPolygon& poly) {
+    out += '(';
+    if (!append_points(out, *poly.getExteriorRing())) {
+        return false;
+    }
+    for (int i = 0; i < poly.getNumInteriorRings(); ++i) {
+        out += ',';
+        if (!append_points(out, *poly.getInteriorRing(i))) {
+            return false;
+        }
+    }
+    out += ')';
+    return true;
+}
+
+// 序列化去掉类型名之后的部分，如 "((0 0,1 0,1 1,0 0))"；类型不受支持或坐标不是有限值时返回 false
+bool append_body(std::string& out, const OGRGeometry& geom) {
+    if (geom.IsEmpty()) {
+        out += "EMPTY"; // 集合中的空成员
+        return true;
+    }
+    switch (wkbFlatten(geom.getGeometryType())) {
+        case wkbPoint: {
+            const OGRPoint* poPoint = geom.toPoint();
+            out += '(';
+            if (!append_xy(out, poPoint->getX(), poPoint->getY())) {
+                return false;
+            }
+            out += ')';
+            return true;
+        }
+        case wkbLineString:
+            return append_points(out, *geom.toSimpleCurve());
+        case wkbPolygon:
+            return append_rings(out, *geom.toPolygon());
+        case wkbMultiPoint: {
+            const OGRGeometryCollection* poColl = geom.toGeometryCollection();
+            out += '(';
+            for (int i = 0; i < poColl->getNumGeometries(); ++i) {
+                const OGRPoint* poPoint = poColl->getGeometryRef(i)->toPoint();
+                if (i) out += ',';
+                if (!append_xy(out, poPoint->getX(), poPoint->getY())) {
+                    return false;
+                }
+            }
+            out += ')';
+            return true;
+        }
+        case wkbMultiLineString:
+        case wkbMultiPolygon: {
+            const OGRGeometryCollection* poColl = geom.toGeometryCollection();
+            out += '(';
+            for (int i = 0; i < poColl->getNumGeometries(); ++i) {
+                if (i) out += ',';
+                if (!append_body(out, *poColl->getGeometryRef(i))) {
+                    return false;
+                }
+            }
+            out += ')';
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+const char* wkt_name(OGRwkbGeometryType eType) {
+    switch (eType) {
+        case wkbPoint: return "POINT";
+        case wkbLineString: return "LINESTRING";
+        case wkbPolygon: return "POLYGON";
+        case wkbMultiPoint: return "MULTIPOINT";
+        case wkbMultiLineString: return "MULTILINESTRING";
+        case wkbMultiPolygon: return "MULTIPOLYGON";
+        case wkbGeometryCollection: return "GEOMETRYCOLLECTION";
+        default: return nullptr;
+    }
+}
+
+// 检查几何 (含集合的所有成员) 是否都是 append_wkt 支持的二维类型
+bool is_supported(const OGRGeometry& geom) {
+    if (geom.getCoordinateDimension() != 2) {
+        return false;
+    }
+    const OGRwkbGeometryType eType = geom.getGeometryType();
+    if (eType == wkbGeometryCollection) {
+        const OGRGeometryCollection* poColl = geom.toGeometryCollection();
+        for (int i = 0; i < poColl->getNumGeometries(); ++i) {
+            if (!is_supported(*poColl->getGeometryRef(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return wkt_name(eType) != nullptr;
+}
+
+void append_quoted(std::string& out, const char* value) {
+    out += '"';
+    for (const char* p = value; *p; ++p) {
+        if (*p == '"') {
+            out += '"'; // CSV 中的双引号需要成对转义
+        }
+        out += *p;
+    }
+    out += '"';
+}
+
+} // namespace
+
+void append_csv_string(std::string& out, const char* value) {
+    if (needs_quoting(value)) {
+        append_quoted(out, value);
+    } else {
+        out += value;
+    }
+}
+
+void append_csv_real(std::string& out, double value) {
+    char buf[32];
+    const auto res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::general, 15);
+    out.append(buf, res.ptr);
+}
+
+bool append_wkt(std::string& out, const OGRGeometry& geom) {
+    if (!is_supported(geom)) {
+        return false;
+    }
+
+    const std::size_t start = out.size();
+    const OGRwkbGeometryType eType = geom.getGeometryType();
+    out += wkt_name(eType);
+    if (geom.IsEmpty()) {
+        out += " EMPTY";
+        return true;
+    }
+
+    out += ' ';
+    bool ok = true;
+    if (eType == wkbGeometryCollection) {
+        const OGRGeometryCollection* poColl = geom.toGeometryCollection();
+        out += '(';
+        for (int i = 0; ok && i < poColl->getNumGeometries(); ++i) {
+            if (i) out += ',';
+            ok = append_wkt(out, *poColl->getGeometryRef(i));
+        }
+        out += ')';
+    } else {
+        ok = append_body(out, geom);
+    }
+    if (!ok) {
+        out.resize(start); // NaN、Inf 坐标交给 exportToWkt，与 OGR 的输出保持一致
+    }
+    return ok;
+}
+
+void append_wkt_number(std::string& out, double value) {
+    if (!append_fixed(out, value, is_int(value))) {
+        out += std::isnan(value) ? "nan" : value > 0 ? "inf" : "-inf";
+    }
+}
+
+void append_csv_point(std::string& out, double x, double y) {
+    const std::size_t start = out.size();
+    out += "\"POINT (";
+    if (append_xy(out, x, y)) {
+        out += ")\"";
+        return;
+    }
+    out.resize(start);
+    const OGRPoint point(x, y);
+    append_csv_wkt(out, &point);
+}
+
+void append_csv_wkt(std::string& out, const OGRGeometry* poGeom) {
+    if (!poGeom) {
+        return;
+    }
+    out += '"';
+    if (!append_wkt(out, *poGeom)) {
+        out += poGeom->exportToWkt();
+    }
+    out += '"';
+}
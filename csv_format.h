@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+
+class OGRGeometry;
+
+/**
+ * @brief 追加一个字符串字段，引号规则与 GDAL CSV 驱动的 STRING_QUOTING=IF_AMBIGUOUS 一致：
+ *        含有逗号、引号、换行、首尾空格，或看起来像数字的字符串会加双引号
+ */
+void append_csv_string(std::string& out, const char* value);
+
+/**
+ * @brief 追加一个浮点字段，格式与 OGR 的 "%.15g" 一致
+ */
+void append_csv_real(std::string& out, double value);
+
+/**
+ * @brief 追加 WKT 几何字段 (带双引号)，几何为空指针时输出空字段
+ *
+ * 二维的点、线、面及其集合类型由 append_wkt 直接序列化，其余类型回退到
+ * OGRGeometry::exportToWkt。
+ */
+void append_csv_wkt(std::string& out, const OGRGeometry* poGeom);
+
+/**
+ * @brief 追加二维点的 WKT 字段 (带双引号)，与 append_csv_wkt 对同一个点的输出一致，但不需要几何对象
+ */
+void append_csv_point(std::string& out, double x, double y);
+
+/**
+ * @brief 直接把二维几何序列化为 WKT (OGC 旧格式，与 OGR 一致)
+ *
+ * 坐标按固定 8 位小数 (即 OGR_WKT_PRECISION=8) 经 std::to_chars 格式化，
+ * 去掉末尾多余的 0；x、y 均为整数时输出为整数，否则至少保留一位小数。
+ *
+ * @return false 如果几何类型不受支持或含有 NaN、Inf 坐标 (此时 out 不变)
+ */
+bool append_wkt(std::string& out, const OGRGeometry& geom);
+
+/**
+ * @brief 追加一个坐标值，格式同 append_wkt
+ */
+void append_wkt_number(std::string& out, double value);
@@ -0,0 +1,388 @@
+#include "edge_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include "gdal_priv.h"
+#include "ogr_api.h"
+#include "ogrsf_frmts.h"
+
+#include "cell_stats.h"
+#include "geometry_stage.h"
+
+namespace {
+
+constexpr int kRcnmEdge = 130; // 空间记录类型：边 (VE)
+constexpr int kOrntReverse = 2;
+
+bool same_point(const OGRRawPoint& a, const OGRRawPoint& b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+// 点到线段的距离的平方
+double segment_distance2(const OGRRawPoint& p, const OGRRawPoint& a, const OGRRawPoint& b) {
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0;
+    t = std::min(std::max(t, 0.0), 1.0);
+    const double ex = a.x + t * dx - p.x;
+    const double ey = a.y + t * dy - p.y;
+    return ex * ex + ey * ey;
+}
+
+// 标记 [first, last] 之间需要保留的顶点 (first、last 本身由调用方标记)
+void douglas_peucker(const std::vector<OGRRawPoint>& points, std::size_t first, std::size_t last,
+                     double tolerance2, std::vector<bool>& keep) {
+    std::vector<std::pair<std::size_t, std::size_t>> stack{{first, last}};
+    while (!stack.empty()) {
+        const auto [a, b] = stack.back();
+        stack.pop_back();
+        double farthest = 0;
+        std::size_t index = a;
+        for (std::size_t i = a + 1; i < b; ++i) {
+            const double d = segment_distance2(points[i], points[a], points[b]);
+            if (d > farthest) {
+                farthest = d;
+                index = i;
+            }
+        }
+        if (farthest > tolerance2) {
+            keep[index] = true;
+            stack.emplace_back(a, index);
+            stack.emplace_back(index, b);
+        }
+    }
+}
+
+// c 在有向线段 ab 的左侧 (1)、右侧 (-1)；共线或在舍入误差范围内无法判断时为 0
+int orientation(const OGRRawPoint& a, const OGRRawPoint& b, const OGRRawPoint& c) {
+    const double left = (a.x - c.x) * (b.y - c.y);
+    const double right = (a.y - c.y) * (b.x - c.x);
+    const double det = left - right;
+    const double bound = 1e-12 * (std::fabs(left) + std::fabs(right)); // 远大于 double 行列式的舍入误差
+    if (det > bound) {
+        return 1;
+    }
+    if (det < -bound) {
+        return -1;
+    }
+    return 0;
+}
+
+struct Segment {
+    double minX, maxX;
+    std::size_t edge;
+    std::size_t index; // 线段的起点在边中的序号
+};
+
+// 扫描线的活动线段按外包矩形的最大 x 排列，已离开扫描线的线段都在开头
+struct ByMaxX {
+    bool operator()(const Segment* a, const Segment* b) const { return a->maxX < b->maxX; }
+};
+
+// 线段端点 (k 为 0 起点、1 终点) 在边中的序号
+std::size_t vertex(const Segment& s, int k) {
+    return s.index + static_cast<std::size_t>(k);
+}
+
+// 两条线段的公共端点是否合法：同一条边上相邻的顶点 (闭合边的首尾是同一个结点)，
+// 或者两条边共用的端点结点
+bool allowed_contact(const Segment& s, int k, const Segment& t, int l,
+                     const std::vector<const std::vector<OGRRawPoint>*>& edges) {
+    const std::size_t lastS = edges[s.edge]->size() - 1;
+    const std::size_t lastT = edges[t.edge]->size() - 1;
+    const bool nodeS = vertex(s, k) == 0 || vertex(s, k) == lastS;
+    const bool nodeT = vertex(t, l) == 0 || vertex(t, l) == lastT;
+    if (s.edge == t.edge) {
+        return vertex(s, k) == vertex(t, l) || (nodeS && nodeT);
+    }
+    return nodeS && nodeT;
+}
+
+// 两条线段除合法的公共端点外是否可能接触；方向判断接近共线时按接触处理
+bool segments_conflict(const Segment& s, const Segment& t, const std::vector<const std::vector<OGRRawPoint>*>& edges) {
+    const OGRRawPoint ps[2] = {(*edges[s.edge])[s.index], (*edges[s.edge])[s.index + 1]};
+    const OGRRawPoint pt[2] = {(*edges[t.edge])[t.index], (*edges[t.edge])[t.index + 1]};
+    if (std::max(pt[0].y, pt[1].y) < std::min(ps[0].y, ps[1].y) ||
+        std::min(pt[0].y, pt[1].y) > std::max(ps[0].y, ps[1].y)) {
+        return false;
+    }
+    for (int k = 0; k < 2; ++k) {
+        for (int l = 0; l < 2; ++l) {
+            if (!same_point(ps[k], pt[l])) {
+                continue;
+            }
+            if (!allowed_contact(s, k, t, l, edges)) {
+                return true;
+            }
+            // 共用一个端点的两条线段只有共线且同向时才会在别处接触
+            const OGRRawPoint& p = ps[k];
+            const OGRRawPoint& a = ps[1 - k];
+            const OGRRawPoint& b = pt[1 - l];
+            return orientation(p, a, b) == 0 && (a.x - p.x) * (b.x - p.x) + (a.y - p.y) * (b.y - p.y) > 0;
+        }
+    }
+    const int o1 = orientation(ps[0], ps[1], pt[0]);
+    const int o2 = orientation(ps[0], ps[1], pt[1]);
+    const int o3 = orientation(pt[0], pt[1], ps[0]);
+    const int o4 = orientation(pt[0], pt[1], ps[1]);
+    if (o1 == 0 || o2 == 0 || o3 == 0 || o4 == 0) {
+        return true;
+    }
+    return o1 != o2 && o3 != o4;
+}
+
+// 扫描线：线段按外包矩形的最小 x 排序，只与 x 区间重叠的活动线段比较；返回与其它边 (或自身) 冲突的边
+std::vector<bool> find_conflicts(const std::vector<const std::vector<OGRRawPoint>*>& edges) {
+    std::vector<Segment> segments;
+    for (std::size_t e = 0; e < edges.size(); ++e) {
+        const std::vector<OGRRawPoint>& pts = *edges[e];
+        for (std::size_t i = 0; i + 1 < pts.size(); ++i) {
+            segments.push_back(Segment{std::min(pts[i].x, pts[i + 1].x), std::max(pts[i].x, pts[i + 1].x), e, i});
+        }
+    }
+    std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) { return a.minX < b.minX; });
+
+    std::vector<bool> conflicts(edges.size(), false);
+    std::multiset<const Segment*, ByMaxX> active;
+    for (const Segment& s : segments) {
+        while (!active.empty() && (*active.begin())->maxX < s.minX) {
+            active.erase(active.begin());
+        }
+        for (const Segment* t : active) {
+            if (segments_conflict(s, *t, edges)) {
+                conflicts[s.edge] = true;
+                conflicts[t->edge] = true;
+            }
+        }
+        active.insert(&s);
+    }
+    return conflicts;
+}
+
+} // namespace
+
+const std::vector<std::string>& shared_edge_open_options() {
+    static const std::vector<std::string> options = {"RETURN_PRIMITIVES=ON", "RETURN_LINKAGES=ON"};
+    return options;
+}
+
+void simplify_edge(std::vector<OGRRawPoint>& points, double tolerance) {
+    const std::size_t n = points.size();
+    if (n <= 2) {
+        return;
+    }
+    std::vector<bool> keep(n, false);
+    keep.front() = keep.back() = true;
+    const double tolerance2 = tolerance * tolerance;
+    const bool closed = same_point(points.front(), points.back());
+    if (closed) {
+        // 首尾重合时以首点为基线没有意义，先在离首点最远的顶点处分段
+        std::size_t split = 0;
+        double farthest = 0;
+        for (std::size_t i = 1; i + 1 < n; ++i) {
+            const double dx = points[i].x - points[0].x;
+            const double dy = points[i].y - points[0].y;
+            if (dx * dx + dy * dy > farthest) {
+                farthest = dx * dx + dy * dy;
+                split = i;
+            }
+        }
+        if (split == 0) {
+            return;
+        }
+        keep[split] = true;
+        douglas_peucker(points, 0, split, tolerance2, keep);
+        douglas_peucker(points, split, n - 1, tolerance2, keep);
+        if (std::count(keep.begin(), keep.end(), true) < 4) {
+            return; // 简化后的环会退化，保留原样
+        }
+    } else {
+        douglas_peucker(points, 0, n - 1, tolerance2, keep);
+    }
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (keep[i]) {
+            points[kept++] = points[i];
+        }
+    }
+    points.resize(kept);
+}
+
+SharedEdgeSimplifier::SharedEdgeSimplifier(GDALDataset& dataset, double tolerance)
+    : m_dataset(dataset), m_tolerance(tolerance) {}
+
+void SharedEdgeSimplifier::load() {
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    OGRLayer* poLayer = m_dataset.GetLayerByName("Edge");
+    if (!poLayer) {
+        return;
+    }
+    const int rcidIndex = poLayer->GetLayerDefn()->GetFieldIndex("RCID");
+    if (rcidIndex < 0) {
+        return;
+    }
+    // 驱动输出的边已包含两端的连接结点
+    for (auto& poFeature : *poLayer) {
+        const OGRGeometry* poGeom = poFeature->GetGeometryRef();
+        if (!poGeom || wkbFlatten(poGeom->getGeometryType()) != wkbLineString) {
+            continue;
+        }
+        const OGRSimpleCurve* poLine = poGeom->toSimpleCurve();
+        Edge& edge = m_edges[poFeature->GetFieldAsInteger(rcidIndex)];
+        edge.original.resize(poLine->getNumPoints());
+        poLine->getPoints(edge.original.data());
+    }
+    poLayer->ResetReading();
+
+    std::vector<Edge*> edges;
+    for (auto& [rcid, edge] : m_edges) {
+        if (edge.original.size() >= 2) {
+            edge.points = edge.original;
+            simplify_edge(edge.points, m_tolerance);
+            edges.push_back(&edge);
+        }
+    }
+    resolve_crossings(edges);
+}
+
+void SharedEdgeSimplifier::resolve_crossings(const std::vector<Edge*>& edges) {
+    // 简化后相交的边降低容差重新简化，仍相交时保留原边；原边之间不相交时最终一定收敛
+    std::vector<const std::vector<OGRRawPoint>*> points;
+    for (const Edge* edge : edges) {
+        points.push_back(&edge->points);
+    }
+    for (;;) {
+        const std::vector<bool> conflicts = find_conflicts(points);
+        bool changed = false;
+        for (std::size_t i = 0; i < edges.size(); ++i) {
+            Edge& edge = *edges[i];
+            if (!conflicts[i] || edge.retries > kMaxRetries) {
+                continue; // 没有冲突，或已是原边 (测绘数据本身相交时无法避免)
+            }
+            ++edge.retries;
+            edge.points = edge.original;
+            if (edge.retries <= kMaxRetries) {
+                simplify_edge(edge.points, m_tolerance / (1 << edge.retries));
+            }
+            changed = true;
+        }
+        if (!changed) {
+            break;
+        }
+    }
+    for (const Edge* edge : edges) {
+        m_adjusted += edge->retries > 0;
+    }
+}
+
+const std::vector<OGRRawPoint>* SharedEdgeSimplifier::edge(int rcid) {
+    auto it = m_edges.find(rcid);
+    if (it == m_edges.end() || it->second.points.size() < 2) {
+        return nullptr;
+    }
+    Edge& edge = it->second;
+    if (!edge.used) {
+        edge.used = true;
+        ++m_simplified;
+    }
+    ++m_uses;
+    return &edge.points;
+}
+
+bool SharedEdgeSimplifier::simplify_and_make_valid(const OGRFeature& feature, CellStats* stats, double grid,
+                                                   OGRGeometryUniquePtr& result) {
+    const OGRGeometry* poGeom = feature.GetGeometryRef();
+    if (!poGeom) {
+        return false;
+    }
+    const OGRwkbGeometryType eType = wkbFlatten(poGeom->getGeometryType());
+    const bool area = eType == wkbPolygon || eType == wkbMultiPolygon;
+    if (!area && eType != wkbLineString && eType != wkbMultiLineString) {
+        return false;
+    }
+
+    const OGRFeatureDefn* defn = feature.GetDefnRef();
+    if (defn != m_linkage.defn) {
+        m_linkage.defn = defn;
+        m_linkage.rcnm = defn->GetFieldIndex("NAME_RCNM");
+        m_linkage.rcid = defn->GetFieldIndex("NAME_RCID");
+        m_linkage.ornt = defn->GetFieldIndex("ORNT");
+    }
+    if (m_linkage.rcnm < 0 || m_linkage.rcid < 0) {
+        return false;
+    }
+    int rcnmCount = 0, rcidCount = 0, orntCount = 0;
+    const int* rcnm = feature.GetFieldAsIntegerList(m_linkage.rcnm, &rcnmCount);
+    const int* rcid = feature.GetFieldAsIntegerList(m_linkage.rcid, &rcidCount);
+    const int* ornt = m_linkage.ornt >= 0 ? feature.GetFieldAsIntegerList(m_linkage.ornt, &orntCount) : nullptr;
+    if (rcidCount == 0 || rcnmCount != rcidCount) {
+        return false;
+    }
+
+    OGRGeometryUniquePtr assembled;
+    {
+        StageTimer timer(stats, Stage::Simplify);
+        load();
+        std::vector<const std::vector<OGRRawPoint>*> edges;
+        for (int i = 0; i < rcidCount; ++i) {
+            const std::vector<OGRRawPoint>* points = rcnm[i] == kRcnmEdge ? edge(rcid[i]) : nullptr;
+            if (!points) {
+                return false;
+            }
+            edges.push_back(points);
+        }
+
+        if (area) {
+            // 与驱动相同，由边组成的线集合构造面，环的方向和内外关系由 OGR 判断
+            OGRGeometryCollection lines;
+            for (const std::vector<OGRRawPoint>* points : edges) {
+                auto* line = new OGRLineString();
+                line->setPoints(static_cast<int>(points->size()), points->data());
+                lines.addGeometryDirectly(line);
+            }
+            OGRErr err = OGRERR_NONE;
+            OGRGeometryH hPolygon = OGRBuildPolygonFromEdges(OGRGeometry::ToHandle(&lines), TRUE, FALSE, 0, &err);
+            if (!hPolygon) {
+                return false;
+            }
+            assembled.reset(OGRGeometry::FromHandle(hPolygon));
+        } else {
+            // 按 ORNT 方向依次连接，首尾不相接时另起一条线
+            std::vector<std::vector<OGRRawPoint>> parts;
+            for (int i = 0; i < rcidCount; ++i) {
+                std::vector<OGRRawPoint> points = *edges[i];
+                if (ornt && i < orntCount && ornt[i] == kOrntReverse) {
+                    std::reverse(points.begin(), points.end());
+                }
+                if (!parts.empty() && same_point(parts.back().back(), points.front())) {
+                    parts.back().insert(parts.back().end(), points.begin() + 1, points.end());
+                } else {
+                    parts.push_back(std::move(points));
+                }
+            }
+            auto make_line = [](const std::vector<OGRRawPoint>& points) {
+                auto* line = new OGRLineString();
+                line->setPoints(static_cast<int>(points.size()), points.data());
+                return line;
+            };
+            if (parts.size() == 1) {
+                assembled.reset(make_line(parts.front()));
+            } else {
+                auto* multi = new OGRMultiLineString();
+                for (const std::vector<OGRRawPoint>& points : parts) {
+                    multi->addGeometryDirectly(make_line(points));
+                }
+                assembled.reset(multi);
+            }
+        }
+    }
+    result = quantize_and_make_valid(std::move(assembled), stats, grid);
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ogr_geometry.h"
+
+class GDALDataset;
+class OGRFeature;
+class OGRFeatureDefn;
+struct CellStats;
+
+/**
+ * @brief 共享边简化需要的打开选项：输出边 (VE) 图层，并为每个要素附加其空间记录的引用
+ */
+const std::vector<std::string>& shared_edge_open_options();
+
+/**
+ * @brief 基于 S-57 链-结点拓扑的简化：每条边只简化一次，引用它的所有线、面要素共用
+ *
+ * 图幅须以 shared_edge_open_options() 打开。边按 Douglas-Peucker 算法简化，
+ * 两端的连接结点 (VC) 保持不动，因此相邻的面 (例如相邻的水深区) 共用的边界
+ * 简化后仍完全重合，不会出现缝隙或重叠，也不会被重复简化。
+ *
+ * 第一次使用时一次简化图幅中的全部边，再用扫描线检查简化后的边之间 (以及
+ * 边自身) 除共用的端点结点外是否相交。相交的边容差减半重新简化，最多
+ * kMaxRetries 次，仍相交则保留原边，这样 MakeValid 不需要分别修复共用的
+ * 边界，两侧的面修复后仍然无缝。要素再按
+ * NAME_RCID/ORNT 引用的边重新组装 (与驱动的 AssembleLineGeometry、
+ * AssembleAreaGeometry 相同)，最后经过 quantize_and_make_valid。
+ *
+ * 不由边组成的要素 (点、多点) 或引用了缺失的边时返回 false，由调用方改用
+ * simplify_and_make_valid。每个打开的数据集一个实例，只由一个工作线程使用。
+ */
+class SharedEdgeSimplifier {
+public:
+    /**
+     * @param tolerance 简化容差 (度)
+     */
+    SharedEdgeSimplifier(GDALDataset& dataset, double tolerance);
+
+    /**
+     * @param result 处理后的几何；GEOS 处理失败时为空 (对应 SQL 中的 NULL)
+     * @return false 如果该要素不能由共享边组装
+     */
+    bool simplify_and_make_valid(const OGRFeature& feature, CellStats* stats, double grid,
+                                 OGRGeometryUniquePtr& result);
+
+    std::size_t edges() const { return m_simplified; }   // 被要素引用的边数
+    std::size_t uses() const { return m_uses; }          // 要素引用边的次数
+    std::size_t adjusted() const { return m_adjusted; }  // 因简化后相交而降低容差或保留原样的边数
+
+private:
+    static constexpr int kMaxRetries = 2; // 相交时容差减半的次数
+
+    struct Edge {
+        std::vector<OGRRawPoint> original;
+        std::vector<OGRRawPoint> points; // 简化后的边
+        int retries = 0;                 // 容差减半的次数，超过 kMaxRetries 表示使用原边
+        bool used = false;
+    };
+
+    // 要素图层中链接字段的序号，同一图层的要素共用
+    struct Linkage {
+        const OGRFeatureDefn* defn = nullptr;
+        int rcnm = -1;
+        int rcid = -1;
+        int ornt = -1;
+    };
+
+    void load();
+    void resolve_crossings(const std::vector<Edge*>& edges);
+    const std::vector<OGRRawPoint>* edge(int rcid);
+
+    GDALDataset& m_dataset;
+    double m_tolerance;
+    bool m_loaded = false;
+    std::unordered_map<int, Edge> m_edges; // 按边的 RCID 索引
+    Linkage m_linkage;
+    std::size_t m_simplified = 0;
+    std::size_t m_uses = 0;
+    std::size_t m_adjusted = 0;
+};
+
+/**
+ * @brief 折线的 Douglas-Peucker 简化，首尾两点总是保留
+ *
+ * 首尾重合的闭合边先在离起点最远的顶点处分成两段分别简化；简化后少于
+ * 4 个顶点的闭合边保持不变，避免环退化。
+ */
+void simplify_edge(std::vector<OGRRawPoint>& points, double tolerance);
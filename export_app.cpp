@@ -0,0 +1,404 @@
+#include "export_app.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "gdal_priv.h"
+
+#include "cell_catalog.h"
+#include "cell_extractor.h"
+#include "cell_pipeline.h"
+#include "cell_prefetch.h"
+#include "cell_stats.h"
+#include "coord_kernel.h"
+#include "csv_format.h"
+#include "extraction_rules.h"
+#include "incremental_cache.h"
+#include "output_sink.h"
+#include "row_dedup.h"
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "miniz.h"
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+void add_export_options(po::options_description& desc, const std::string& defaultName) {
+    desc.add_options()
+        ("help,h", "显示帮助信息")
+        ("input-dir,i", po::value<std::string>()->required(), "包含S57文件的输入目录，其中的 .zip/.tar/.tar.gz 交换集压缩包直接读取，不需要解压 (也可以直接指定一个压缩包)")
+        ("output-dir,o", po::value<std::string>()->required(), "输出CSV文件的目录");
+    if (!defaultName.empty()) {
+        desc.add_options()
+            ("output-name,n", po::value<std::string>()->default_value(defaultName), "输出的CSV文件名 (不含后缀)");
+    }
+    desc.add_options()
+        ("jobs,j", po::value<unsigned>()->default_value(1), "并行处理图幅的工作线程数 (0 表示使用全部CPU核心)")
+        ("queue-memory", po::value<std::size_t>()->default_value(512), "等待写出的结果最多占用的内存 (MB)，超过时工作线程暂停 (0 表示不限制)")
+        ("prefetch", po::value<std::size_t>()->default_value(0), "预读：由单独的 I/O 线程提前把若干个图幅 (含更新文件) 读入内存，工作线程从内存打开；适合输入目录位于网络盘或 WSL 挂载盘 (0 表示不预读)")
+        ("zip,z", po::bool_switch(), "直接输出压缩后的 ZIP 文件 (CSV 不落盘)")
+        ("zip-level", po::value<int>()->default_value(MZ_DEFAULT_LEVEL), "ZIP 压缩级别 (0-10)")
+        ("zip-threads", po::value<unsigned>()->default_value(1), "ZIP 分块并行压缩的线程数 (0 表示使用全部CPU核心)")
+        ("incremental", po::bool_switch(), "增量导出：保留输出目录中的缓存，只重新处理新增或变化的图幅")
+        ("format", po::value<std::string>()->default_value("csv"), "输出格式: csv (WKT 文本)、fgb (FlatGeobuf) 或 parquet (GeoParquet)")
+        ("tile-size", po::value<double>()->default_value(0), "按经纬度网格切分输出，网格边长 (度)；每个网格一个 CSV 分片并生成分片索引 (0 表示不切分)")
+        ("tolerance", po::value<std::vector<std::string>>()->multitoken(), "简化容差 (度)：LEVEL=VALUE 设置某一航行用途等级 (1-6)，单独的 VALUE 设置所有等级；默认按等级 1-6 依次为 0.0025 0.001 0.0005 0.00025 0.0001 0.00005")
+        ("quantize", po::bool_switch(), "简化后先把坐标量化到输出精度 (1e-8 度) 并去掉重复顶点，再修复几何；修复针对的是实际输出的坐标，输出可能与不量化时在末位略有不同")
+        ("shared-edges", po::bool_switch(), "按 S-57 共享边简化线和面：每条边只简化一次，相邻要素的公共边界简化后仍然重合 (不使用 --geometry-cache)")
+        ("dedup", po::bool_switch(), "跨图幅去重：图层、属性和几何都相同的要素只输出一次，保留等级最高 (比例尺最大) 的图幅中的那一份")
+        ("geometry-cache", po::value<std::string>(), "几何缓存目录：保存简化和修复后的几何，下次运行时未变化的要素不再重新计算")
+        ("bbox", po::value<std::string>(), "只导出与经纬度范围 MINX,MINY,MAXX,MAXY 相交的要素；配合 --catalog 时范围之外的图幅不再打开")
+        ("levels", po::value<std::string>(), "只处理这些航行用途等级的图幅 (按文件名第三位判断，不打开图幅)，如 3,4,5")
+        ("catalog", po::value<std::string>(), "图幅目录文件：记录每个图幅包含的图层、航行用途和范围，下次运行时不含目标图层的未变化图幅不再打开")
+        ("stats", po::value<std::string>(), "把每个图幅各阶段的耗时和要素、顶点、字节计数写入报告文件 (后缀为 .csv 时为 CSV，否则为 JSON)")
+        ("serve", po::bool_switch(), "服务模式：GDAL 只初始化一次，从标准输入逐行读取导出作业并依次执行，每行为一组本工具的参数 (不含程序名)；一行 quit 表示退出")
+        ("socket", po::value<std::string>(), "服务模式下从该本地 (Unix 域) 套接字读取作业，代替标准输入；每个连接可以提交多个作业")
+        ("serve-jobs", po::value<unsigned>()->default_value(1), "服务模式下同时执行的作业数 (各作业的 --jobs 分别计算)");
+}
+
+bool parse_export_options(int argc, char* argv[], const po::options_description& desc,
+                          po::variables_map& vm, ExportOptions& options, int& exitCode) {
+    const std::vector<std::string> args = argc > 1 ? std::vector<std::string>(argv + 1, argv + argc)
+                                                   : std::vector<std::string>();
+    return parse_export_options(args, desc, vm, options, exitCode);
+}
+
+bool parse_export_options(const std::vector<std::string>& args, const po::options_description& desc,
+                          po::variables_map& vm, ExportOptions& options, int& exitCode) {
+    try {
+        po::store(po::command_line_parser(args).options(desc).run(), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            exitCode = 0;
+            return false;
+        }
+
+        // 服务模式的输入、输出目录由各个作业给出
+        if (!vm["serve"].as<bool>()) {
+            po::notify(vm); // 检查 "required" 选项是否存在
+        }
+    } catch (const po::error& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        std::cerr << desc << std::endl;
+        exitCode = 1;
+        return false;
+    }
+
+    exitCode = 1;
+    if (vm["serve"].as<bool>()) {
+        options.serve = true;
+        if (vm.count("socket")) {
+            options.socketPath = vm["socket"].as<std::string>();
+        }
+        options.serveJobs = vm["serve-jobs"].as<unsigned>();
+        if (options.serveJobs == 0) {
+            std::cerr << "错误: --serve-jobs 至少为 1" << std::endl;
+            return false;
+        }
+        exitCode = 0;
+        return true;
+    }
+    if (vm.count("socket")) {
+        std::cerr << "错误: --socket 只能与 --serve 同时使用" << std::endl;
+        return false;
+    }
+    options.inputDir = vm["input-dir"].as<std::string>();
+    options.outputDir = vm["output-dir"].as<std::string>();
+    if (vm.count("output-name")) {
+        options.outputName = vm["output-name"].as<std::string>();
+    }
+    options.jobs = vm["jobs"].as<unsigned>();
+    options.maxPendingBytes = vm["queue-memory"].as<std::size_t>() << 20;
+    options.prefetch = vm["prefetch"].as<std::size_t>();
+    options.zip = vm["zip"].as<bool>();
+    options.incremental = vm["incremental"].as<bool>();
+    options.dedup = vm["dedup"].as<bool>();
+    options.quantize = vm["quantize"].as<bool>();
+    options.sharedEdges = vm["shared-edges"].as<bool>();
+    options.zipLevel = vm["zip-level"].as<int>();
+    if (options.zipLevel < MZ_NO_COMPRESSION || options.zipLevel > MZ_UBER_COMPRESSION) {
+        std::cerr << "错误: --zip-level 必须在 0 到 10 之间" << std::endl;
+        return false;
+    }
+    if (!parse_output_format(vm["format"].as<std::string>(), options.format)) {
+        std::cerr << "错误: 不支持的输出格式 '" << vm["format"].as<std::string>() << "'" << std::endl;
+        return false;
+    }
+    options.tileSize = vm["tile-size"].as<double>();
+    if (options.tileSize != 0 && !(options.tileSize >= 1e-6)) {
+        std::cerr << "错误: --tile-size 必须为 0 或不小于 1e-6 的正数" << std::endl;
+        return false;
+    }
+    if (options.tileSize > 0 && options.zip) {
+        std::cerr << "错误: --tile-size 暂不支持与 --zip 同时使用" << std::endl;
+        return false;
+    }
+    if (options.format != OutputFormat::Csv && (options.zip || options.tileSize > 0)) {
+        std::cerr << "错误: --zip 和 --tile-size 只支持 CSV 格式输出" << std::endl;
+        return false;
+    }
+    if (vm.count("tolerance")) {
+        for (const std::string& item : vm["tolerance"].as<std::vector<std::string>>()) {
+            const std::size_t eq = item.find('=');
+            double value = 0;
+            try {
+                value = std::stod(item.substr(eq == std::string::npos ? 0 : eq + 1));
+            } catch (const std::exception&) {
+                value = -1;
+            }
+            const bool valid = value >= 0 && (eq == std::string::npos ||
+                                              (eq == 1 && options.tolerances.set(item[0], value)));
+            if (!valid) {
+                std::cerr << "错误: 无效的 --tolerance 参数 '" << item << "'" << std::endl;
+                return false;
+            }
+            if (eq == std::string::npos) {
+                options.tolerances.set_all(value);
+            }
+        }
+    }
+    if (vm.count("geometry-cache")) {
+        options.geometryCacheDir = vm["geometry-cache"].as<std::string>();
+    }
+    if (vm.count("stats")) {
+        options.statsPath = vm["stats"].as<std::string>();
+    }
+    if (vm.count("catalog")) {
+        options.catalogPath = vm["catalog"].as<std::string>();
+    }
+    if (vm.count("bbox")) {
+        const std::string& text = vm["bbox"].as<std::string>();
+        BoundingBox bbox;
+        char tail = 0;
+        if (std::sscanf(text.c_str(), "%lf,%lf,%lf,%lf%c", &bbox.minX, &bbox.minY, &bbox.maxX, &bbox.maxY, &tail) != 4 ||
+            !(bbox.minX <= bbox.maxX) || !(bbox.minY <= bbox.maxY)) {
+            std::cerr << "错误: 无效的 --bbox 参数 '" << text << "'，应为 MINX,MINY,MAXX,MAXY" << std::endl;
+            return false;
+        }
+        options.bbox = bbox;
+    }
+    if (vm.count("levels")) {
+        for (char c : vm["levels"].as<std::string>()) {
+            if (c == ',' || c == ' ') {
+                continue;
+            }
+            if (c < '1' || c > '6') {
+                std::cerr << "错误: 无效的 --levels 参数 '" << vm["levels"].as<std::string>() << "'，等级应为 1-6"
+                          << std::endl;
+                return false;
+            }
+            if (options.levels.find(c) == std::string::npos) {
+                options.levels += c;
+            }
+        }
+        if (options.levels.empty()) {
+            std::cerr << "错误: --levels 至少需要一个等级" << std::endl;
+            return false;
+        }
+    }
+    options.zipThreads = vm["zip-threads"].as<unsigned>();
+    if (options.zipThreads == 0) {
+        options.zipThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    exitCode = 0;
+    return true;
+}
+
+std::unique_ptr<OutputSink> make_output_sink(const ExportOptions& options, const ExportTarget& target) {
+    const fs::path outputDir(options.outputDir);
+    const std::string& outputName = target.name;
+    if (options.format != OutputFormat::Csv) {
+        const std::string fileName = outputName + "." + output_format_extension(options.format);
+        return std::make_unique<OgrDatasetSink>((outputDir / fileName).string(), options.format, outputName,
+                                                target.rules->fields());
+    }
+    if (options.tileSize > 0) {
+        return std::make_unique<TiledCsvSink>(options.outputDir, outputName, options.tileSize);
+    }
+    if (options.zip) {
+        return std::make_unique<ZipFileSink>((outputDir / (outputName + ".zip")).string(),
+                                             outputName + ".csv", options.zipLevel, options.zipThreads);
+    }
+    return std::make_unique<CsvFileSink>((outputDir / (outputName + ".csv")).string());
+}
+
+void init_gdal() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        GDALAllRegister();
+        CPLSetConfigOption("OGR_WKT_PRECISION", "8");
+    });
+}
+
+int run_export(const ExportOptions& options, const std::vector<ExportTarget>& targets) {
+    // --- 初始化 GDAL ---
+    init_gdal();
+
+    // --- 准备输出目录 ---
+    // 增量模式下保留输出目录中的清单和分片缓存；其余情况不创建目录，由写出线程在第一次写入时创建
+    if (!options.incremental && fs::exists(options.outputDir)) {
+        std::cout << "已删除旧的输出目录: " << options.outputDir << std::endl;
+        fs::remove_all(options.outputDir);
+    }
+
+    ExtractSettings settings;
+    settings.format = options.format;
+    settings.tileSize = options.tileSize;
+    settings.geometryCacheDir = options.geometryCacheDir;
+    settings.tolerances = options.tolerances;
+    settings.dedup = options.dedup;
+    settings.bbox = options.bbox;
+    settings.grid = options.quantize ? kWktGrid : 0; // 与 OGR_WKT_PRECISION 一致
+    settings.sharedEdges = options.sharedEdges;
+    std::unique_ptr<CellCatalog> ownCatalog;
+    CellCatalog* catalog = options.catalog;
+    if (!catalog && !options.catalogPath.empty()) {
+        ownCatalog = std::make_unique<CellCatalog>(options.catalogPath);
+        ownCatalog->load();
+        catalog = ownCatalog.get();
+    }
+    std::atomic<std::size_t> unopened{0};
+    settings.catalog = catalog;
+    settings.unopened = &unopened;
+    std::vector<const ExtractionRules*> rules;
+    for (const ExportTarget& target : targets) {
+        rules.push_back(target.rules);
+    }
+    auto process_cell = [&](const S57Cell& cell, std::size_t /*index*/, const std::vector<bool>& wanted,
+                            std::vector<CellResult>& results, CellStats* stats) {
+        extract_cell(cell, rules, wanted, settings, results, stats);
+    };
+    const auto start = std::chrono::steady_clock::now();
+
+    // --- 遍历输入目录中的所有 .000 文件并行处理，按顺序写出 ---
+    try {
+        std::vector<S57Cell> cells = collect_s57_cells(options.inputDir);
+        if (catalog) {
+            catalog->prune(options.inputDir, cells); // 在按等级筛选之前清理，未选中等级的图幅的记录仍然保留
+        }
+        if (!options.levels.empty()) {
+            // 等级由文件名决定，不需要打开图幅；增量清单同样只保留本次处理的图幅
+            const std::size_t scanned = cells.size();
+            cells.erase(std::remove_if(cells.begin(), cells.end(),
+                                       [&](const S57Cell& cell) {
+                                           return options.levels.find(cell_level(cell)) == std::string::npos;
+                                       }),
+                        cells.end());
+            std::cout << "按等级 " << options.levels << " 筛选: 保留 " << cells.size() << "/" << scanned << " 个图幅"
+                      << std::endl;
+        }
+        if (options.dedup) {
+            // 去重时保留先写出的一份，因此按等级从高到低处理，同等级内仍按路径排序
+            std::stable_sort(cells.begin(), cells.end(), [](const S57Cell& a, const S57Cell& b) {
+                return cell_level(a) > cell_level(b);
+            });
+        }
+
+        // 输出端只创建一次，所有图幅共用，处理结束后统一刷新关闭
+        std::vector<std::unique_ptr<OutputSink>> sinks;
+        std::vector<std::unique_ptr<IncrementalCache>> caches;
+        std::vector<std::unique_ptr<RowDeduplicator>> dedups;
+        std::vector<PipelineOutput> outputs;
+        for (const ExportTarget& target : targets) {
+            sinks.push_back(make_output_sink(options, target));
+            caches.emplace_back();
+            if (options.incremental) {
+                // 增量缓存的参数签名：规则或输出格式变化时缓存失效
+                std::string signature = target.rules->signature() + ";TOLERANCE=" + options.tolerances.signature();
+                if (options.format != OutputFormat::Csv) {
+                    signature += std::string(";FORMAT=") + output_format_extension(options.format);
+                }
+                if (options.tileSize > 0) {
+                    signature += ";TILE=";
+                    append_csv_real(signature, options.tileSize);
+                }
+                if (options.dedup) {
+                    signature += ";DEDUP";
+                }
+                if (options.quantize) {
+                    signature += ";QUANTIZE";
+                }
+                if (options.sharedEdges) {
+                    signature += ";SHARED_EDGES";
+                }
+                if (options.bbox) {
+                    signature += ";BBOX=";
+                    for (double value : {options.bbox->minX, options.bbox->minY, options.bbox->maxX, options.bbox->maxY}) {
+                        append_csv_real(signature, value);
+                        signature += ',';
+                    }
+                }
+
+                const fs::path outputDir(options.outputDir);
+                caches.back() = std::make_unique<IncrementalCache>((outputDir / ".cells" / target.name).string(),
+                                                                   (outputDir / (target.name + ".manifest")).string(),
+                                                                   signature);
+                caches.back()->load(cells.size());
+            }
+            dedups.push_back(options.dedup ? std::make_unique<RowDeduplicator>() : nullptr);
+            outputs.push_back(PipelineOutput{sinks.back().get(), caches.back().get(), dedups.back().get()});
+        }
+
+        std::unique_ptr<CellPrefetcher> prefetcher;
+        if (options.prefetch > 0) {
+            prefetcher = std::make_unique<CellPrefetcher>(cells, options.prefetch);
+        }
+        std::vector<CellStats> stats;
+        bool ok = run_cell_pipeline(cells, options.jobs, process_cell, outputs, options.maxPendingBytes,
+                                    options.statsPath.empty() ? nullptr : &stats, prefetcher.get());
+        prefetcher.reset();
+        for (auto& sink : sinks) {
+            ok = sink->close() && ok;
+        }
+        if (catalog) {
+            // 目录只记录图幅内容，与本次导出是否成功无关
+            std::cout << "图幅目录: " << unopened << "/" << cells.size()
+                      << " 个图幅不含目标图层或在 --bbox 之外，未打开" << std::endl;
+            ok = catalog->save() && ok;
+        }
+        if (!options.statsPath.empty()) {
+            // 报告写在输出之外，即使导出失败也保留，便于定位出问题的图幅
+            const double wallSeconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (write_stats_report(options.statsPath, cells, stats, wallSeconds)) {
+                std::cout << "统计报告已写入: " << options.statsPath << std::endl;
+            } else {
+                std::cerr << "错误: 无法写入统计报告 " << options.statsPath << std::endl;
+                ok = false;
+            }
+        }
+        if (!ok) {
+            return 1;
+        }
+        for (std::size_t t = 0; t < targets.size(); ++t) {
+            if (dedups[t]) {
+                std::cout << "去重 (" << targets[t].name << "): 丢弃 " << dedups[t]->dropped() << " 行重复数据" << std::endl;
+            }
+            if (caches[t]) {
+                std::cout << "增量导出 (" << targets[t].name << "): " << caches[t]->reused() << "/" << cells.size()
+                          << " 个图幅未变化，复用缓存" << std::endl;
+                if (!caches[t]->save()) {
+                    return 1;
+                }
+            }
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "文件系统错误: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "所有文件处理完毕！输出已生成在目录 '" << options.outputDir << "' 中。" << std::endl;
+    return 0;
+}
+
+int run_export(const ExportOptions& options, const ExtractionRules& rules) {
+    return run_export(options, {ExportTarget{options.outputName, &rules}});
+}
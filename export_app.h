@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "cell_extractor.h"
+#include "geometry_stage.h"
+#include "row_encoder.h"
+
+class CellCatalog;
+class ExtractionRules;
+class OutputSink;
+
+/**
+ * @brief 两个导出工具共用的命令行参数
+ */
+struct ExportOptions {
+    std::string inputDir;
+    std::string outputDir;
+    std::string outputName;
+    unsigned jobs = 1;
+    std::size_t maxPendingBytes = 0;
+    std::size_t prefetch = 0; // 提前读入内存的图幅数，0 表示不预读
+    bool zip = false;
+    int zipLevel = 0;
+    unsigned zipThreads = 1;
+    bool incremental = false;
+    OutputFormat format = OutputFormat::Csv;
+    double tileSize = 0;
+    bool quantize = false;
+    bool sharedEdges = false;
+    std::string geometryCacheDir;
+    ToleranceTable tolerances;
+    bool dedup = false;
+    std::string statsPath; // 为空表示不生成统计报告
+    std::string catalogPath; // 图幅目录文件，为空表示不使用 (见 CellCatalog)
+    std::optional<BoundingBox> bbox; // 只导出与该范围相交的要素
+    std::string levels;              // 只处理这些航行用途等级 ('1' - '6') 的图幅，为空表示全部
+    bool serve = false;              // 服务模式 (见 run_export_tool)，此时上面的参数都由作业给出
+    std::string socketPath;          // 服务模式下监听的本地套接字，为空表示从标准输入读取作业
+    unsigned serveJobs = 1;          // 服务模式下同时执行的作业数
+    CellCatalog* catalog = nullptr;  // 服务模式下各作业共用的 catalogPath 目录，为空时由 run_export 读取
+};
+
+/**
+ * @brief 一次导出中的一个输出：输出名 (不含后缀) 及其提取规则
+ */
+struct ExportTarget {
+    std::string name;
+    const ExtractionRules* rules;
+};
+
+/**
+ * @brief 注册共用的命令行参数
+ *
+ * @param defaultName 输出文件名 (不含后缀) 的默认值；为空时不注册 --output-name
+ */
+void add_export_options(boost::program_options::options_description& desc, const std::string& defaultName);
+
+/**
+ * @brief 解析命令行并读出共用参数，显示帮助或参数错误时输出相应信息
+ *
+ * @param vm 解析结果，调用方可以从中读取工具自己的参数
+ * @param exitCode 返回 false 时程序应使用的退出码
+ * @return false 如果程序应该直接退出
+ */
+bool parse_export_options(int argc, char* argv[], const boost::program_options::options_description& desc,
+                          boost::program_options::variables_map& vm, ExportOptions& options, int& exitCode);
+
+/**
+ * @brief 同上，参数为不含程序名的参数列表 (服务模式下的一个作业)
+ */
+bool parse_export_options(const std::vector<std::string>& args, const boost::program_options::options_description& desc,
+                          boost::program_options::variables_map& vm, ExportOptions& options, int& exitCode);
+
+/**
+ * @brief 初始化 GDAL (注册驱动、设置 WKT 精度)，整个进程只执行一次 (线程安全)
+ */
+void init_gdal();
+
+/**
+ * @brief 按参数创建输出端 (CSV、切分 CSV、ZIP 或 GDAL 二进制格式)
+ */
+std::unique_ptr<OutputSink> make_output_sink(const ExportOptions& options, const ExportTarget& target);
+
+/**
+ * @brief 执行一次完整的导出：初始化 GDAL、准备输出目录、扫描图幅、并行提取并按顺序写出
+ *
+ * 多个输出共用一次扫描和每个图幅的一次打开 (见 extract_cell)，各自写到
+ * 输出目录下自己的文件，并各自维护增量缓存。
+ *
+ * @return 进程退出码
+ */
+int run_export(const ExportOptions& options, const std::vector<ExportTarget>& targets);
+
+/**
+ * @brief 单个输出的导出，输出名取 options.outputName
+ */
+int run_export(const ExportOptions& options, const ExtractionRules& rules);
@@ -0,0 +1,508 @@
+#include "export_service.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+
+#include "cell_catalog.h"
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+namespace {
+
+constexpr const char* kQuitCommand = "quit";
+
+// 向提交作业的一方回复一行，可能由多个作业线程同时调用
+using ReplyFn = std::function<void(const std::string& line)>;
+
+struct Job {
+    std::size_t id;
+    std::string line;
+    ReplyFn reply;
+};
+
+// 当前线程正在执行的作业，它输出的日志行以此开头
+thread_local std::string t_jobTag;
+
+/**
+ * @brief 服务模式下 std::cout / std::cerr 的缓冲：按行整行写出，并在行首加上作业序号
+ *
+ * 多个作业线程同时输出日志，标准输入模式下还与回复共用标准输出；每个线程
+ * 先把不完整的行攒在自己的缓冲里，凑满一行后在锁内整行写出，行与行不会交错。
+ */
+class JobLogBuffer : public std::streambuf {
+public:
+    JobLogBuffer(std::ostream& stream, std::mutex& mutex)
+        : m_stream(stream), m_mutex(mutex), m_target(stream.rdbuf(this)) {}
+
+    ~JobLogBuffer() override { m_stream.rdbuf(m_target); }
+
+protected:
+    int overflow(int c) override {
+        if (c != traits_type::eof()) {
+            const char ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        std::string& line = pending();
+        std::string lines;
+        const char* end = s + n;
+        for (const char* p = s; p != end;) {
+            const char* newline = std::find(p, end, '\n');
+            line.append(p, newline);
+            if (newline == end) {
+                break;
+            }
+            lines += t_jobTag;
+            lines += line;
+            lines += '\n';
+            line.clear();
+            p = newline + 1;
+        }
+        if (!lines.empty()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_target->sputn(lines.data(), static_cast<std::streamsize>(lines.size()));
+        }
+        return n;
+    }
+
+    int sync() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_target->pubsync();
+    }
+
+private:
+    // 当前线程尚未凑满一行的输出
+    std::string& pending() {
+        thread_local std::map<const JobLogBuffer*, std::string> lines;
+        return lines[this];
+    }
+
+    std::ostream& m_stream;
+    std::mutex& m_mutex;
+    std::streambuf* m_target;
+};
+
+/**
+ * @brief 作业队列和执行作业的线程，以及各作业共用的图幅目录
+ */
+class ExportService {
+public:
+    ExportService(const po::options_description& desc, const ExportJob& job, unsigned workers)
+        : m_desc(desc), m_job(job) {
+        for (unsigned i = 0; i < workers; ++i) {
+            m_workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ExportService() { finish(); }
+
+    /**
+     * @brief 提交一行作业；空行和 # 开头的注释行忽略
+     *
+     * @return false 如果服务已不再接收作业 (收到 quit)
+     */
+    bool submit(std::string line, const ReplyFn& reply) {
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+            line.pop_back();
+        }
+        const std::size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') {
+            return !closed();
+        }
+        line.erase(0, start);
+
+        std::size_t id = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed) {
+                reply("错误: 服务正在退出，未接收作业: " + line);
+                return false;
+            }
+            if (line == kQuitCommand) {
+                m_closed = true;
+                m_ready.notify_all();
+                m_quit.notify_all();
+                return false;
+            }
+            id = m_nextId++;
+            m_queue.push_back(Job{id, line, reply});
+        }
+        m_ready.notify_one();
+        reply("作业 " + std::to_string(id) + " 已排队");
+        return true;
+    }
+
+    /**
+     * @brief 等待收到 quit
+     */
+    void wait_quit() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_quit.wait(lock, [&] { return m_closed; });
+    }
+
+    /**
+     * @brief 停止接收作业，等待已收到的作业执行完毕
+     */
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_ready.notify_all();
+        m_quit.notify_all();
+        for (std::thread& worker : m_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+private:
+    bool closed() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+
+    void work() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_ready.wait(lock, [&] { return m_closed || !m_queue.empty(); });
+                if (m_queue.empty()) {
+                    return; // 已关闭且没有剩余的作业
+                }
+                job = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            const int exitCode = run(job);
+            job.reply("作业 " + std::to_string(job.id) + " 结束: 退出码 " + std::to_string(exitCode));
+        }
+    }
+
+    int run(const Job& job) {
+        std::cout << "=== 作业 " << job.id << ": " << job.line << std::endl;
+        const JobTag tag(job.id);
+        std::vector<std::string> args;
+        try {
+            args = po::split_unix(job.line);
+        } catch (const std::exception& e) {
+            std::cerr << "错误: 作业 " << job.id << " 的参数无法解析: " << e.what() << std::endl;
+            return 1;
+        }
+
+        po::variables_map vm;
+        ExportOptions options;
+        int exitCode = 0;
+        if (!parse_export_options(args, m_desc, vm, options, exitCode)) {
+            return exitCode;
+        }
+        if (options.serve) {
+            std::cerr << "错误: 作业中不能使用 --serve" << std::endl;
+            return 1;
+        }
+        if (!options.catalogPath.empty()) {
+            options.catalog = catalog(options.catalogPath);
+        }
+        const DirectoryLease lease(*this, job.id, job_directories(options));
+        try {
+            return m_job(vm, options);
+        } catch (const std::exception& e) {
+            // 一个作业失败不影响服务和其它作业
+            std::cerr << "错误: 作业 " << job.id << " 异常结束: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // 作业运行期间，当前线程输出的日志行以 "[作业序号] " 开头
+    struct JobTag {
+        explicit JobTag(std::size_t id) { t_jobTag = "[" + std::to_string(id) + "] "; }
+        ~JobTag() { t_jobTag.clear(); }
+    };
+
+    /**
+     * @brief 作业运行期间占用它的输出目录和几何缓存目录
+     *
+     * 输出目录在导出开始时整个删除重建，几何缓存目录会被改写；与先提交的作业
+     * 的这些目录相同或互相包含的作业，等先提交的作业结束后再开始，因此同一个
+     * 目录的作业按提交顺序执行。
+     */
+    class DirectoryLease {
+    public:
+        DirectoryLease(ExportService& service, std::size_t id, const std::vector<fs::path>& dirs)
+            : m_service(service), m_id(id) {
+            std::unique_lock<std::mutex> lock(m_service.m_dirMutex);
+            for (const fs::path& dir : dirs) {
+                m_service.m_dirUsers.emplace(m_id, dir);
+            }
+            if (!m_service.dirs_free(m_id)) {
+                std::cout << "作业 " << m_id << " 的输出目录或几何缓存目录正被其它作业使用，等待其结束" << std::endl;
+                m_service.m_dirsFreed.wait(lock, [&] { return m_service.dirs_free(m_id); });
+            }
+        }
+
+        ~DirectoryLease() {
+            {
+                std::lock_guard<std::mutex> lock(m_service.m_dirMutex);
+                m_service.m_dirUsers.erase(m_id);
+            }
+            m_service.m_dirsFreed.notify_all();
+        }
+
+    private:
+        ExportService& m_service;
+        std::size_t m_id;
+    };
+
+    // 与 m_catalogs 的键一样取规范化的绝对路径
+    static std::vector<fs::path> job_directories(const ExportOptions& options) {
+        std::vector<fs::path> dirs;
+        for (const std::string* dir : {&options.outputDir, &options.geometryCacheDir}) {
+            if (dir->empty()) {
+                continue;
+            }
+            fs::path normal = fs::absolute(*dir).lexically_normal();
+            if (normal.filename() == ".") {
+                normal = normal.parent_path(); // 以 / 结尾的目录
+            }
+            dirs.push_back(normal);
+        }
+        return dirs;
+    }
+
+    // 两个目录相同或一个包含另一个
+    static bool dirs_overlap(const fs::path& a, const fs::path& b) {
+        const auto mismatch = std::mismatch(a.begin(), a.end(), b.begin(), b.end());
+        return mismatch.first == a.end() || mismatch.second == b.end();
+    }
+
+    // 作业 id 的目录是否与先提交的作业都不重叠 (持有 m_dirMutex 时调用)
+    bool dirs_free(std::size_t id) const {
+        const auto own = m_dirUsers.equal_range(id);
+        for (auto earlier = m_dirUsers.begin(); earlier != own.first; ++earlier) {
+            for (auto dir = own.first; dir != own.second; ++dir) {
+                if (dirs_overlap(dir->second, earlier->second)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // 同一个目录文件只读取一次，之后的作业直接使用内存中的记录
+    CellCatalog* catalog(const std::string& path) {
+        const std::string key = fs::absolute(path).lexically_normal().string();
+        std::lock_guard<std::mutex> lock(m_catalogMutex);
+        std::unique_ptr<CellCatalog>& catalog = m_catalogs[key];
+        if (!catalog) {
+            catalog = std::make_unique<CellCatalog>(key);
+            catalog->load();
+        }
+        return catalog.get();
+    }
+
+    const po::options_description& m_desc;
+    const ExportJob& m_job;
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready; // 有新作业或队列关闭
+    std::condition_variable m_quit;  // 队列关闭
+    std::deque<Job> m_queue;
+    bool m_closed = false;
+    std::size_t m_nextId = 1;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_catalogMutex;
+    std::map<std::string, std::unique_ptr<CellCatalog>> m_catalogs; // 按目录文件的绝对路径索引
+
+    std::mutex m_dirMutex;
+    std::condition_variable m_dirsFreed;             // 有作业结束，释放了它的目录
+    std::multimap<std::size_t, fs::path> m_dirUsers; // 正在运行或等待的作业占用的目录，按作业序号排列
+};
+
+int serve_stdin(ExportService& service) {
+    // 回复与日志共用标准输出，由 JobLogBuffer 保证整行写出
+    const ReplyFn reply = [](const std::string& line) { std::cout << line << std::endl; };
+    std::cout << "服务已启动，从标准输入读取作业" << std::endl;
+    std::string line;
+    while (std::getline(std::cin, line) && service.submit(line, reply)) {
+    }
+    service.finish(); // 输入结束 (EOF) 与 quit 相同
+    return 0;
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+using boost::asio::local::stream_protocol;
+
+// 一个客户端连接，只在 I/O 线程中访问；作业线程的回复通过 post 交给 I/O 线程写出
+struct Connection {
+    explicit Connection(stream_protocol::socket s) : socket(std::move(s)) {}
+
+    stream_protocol::socket socket;
+    boost::asio::streambuf buffer;
+};
+
+class SocketServer {
+public:
+    SocketServer(ExportService& service, boost::asio::io_context& io) : m_service(service), m_io(io), m_acceptor(io) {}
+
+    bool listen(const std::string& path) {
+        boost::system::error_code ec;
+        if (fs::status(path, ec).type() == fs::socket_file) {
+            fs::remove(path, ec); // 上次异常退出时遗留的套接字文件
+        }
+        const stream_protocol::endpoint endpoint(path);
+        m_acceptor.open(endpoint.protocol(), ec);
+        if (!ec) {
+            m_acceptor.bind(endpoint, ec);
+        }
+        if (!ec) {
+            m_acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+        }
+        if (ec) {
+            std::cerr << "错误: 无法监听本地套接字 " << path << ": " << ec.message() << std::endl;
+            return false;
+        }
+        accept();
+        return true;
+    }
+
+    /**
+     * @brief 停止接受新连接 (在 I/O 线程中调用)
+     */
+    void stop_accepting() {
+        boost::system::error_code ec;
+        m_acceptor.close(ec);
+    }
+
+    /**
+     * @brief 关闭所有连接 (在 I/O 线程中调用)，此后 io_context 没有待处理的操作
+     */
+    void close_connections() {
+        for (const std::shared_ptr<Connection>& connection : m_connections) {
+            boost::system::error_code ec;
+            connection->socket.close(ec);
+        }
+        m_connections.clear();
+    }
+
+private:
+    void accept() {
+        m_acceptor.async_accept([this](const boost::system::error_code& ec, stream_protocol::socket socket) {
+            if (ec) {
+                return; // 已停止接受连接
+            }
+            auto connection = std::make_shared<Connection>(std::move(socket));
+            m_connections.insert(connection);
+            read(connection);
+            accept();
+        });
+    }
+
+    void read(const std::shared_ptr<Connection>& connection) {
+        boost::asio::async_read_until(
+            connection->socket, connection->buffer, '\n',
+            [this, connection](const boost::system::error_code& ec, std::size_t /*bytes*/) {
+                if (ec) {
+                    m_connections.erase(connection); // 客户端断开；尚未结束的作业照常执行
+                    return;
+                }
+                std::istream in(&connection->buffer);
+                std::string line;
+                std::getline(in, line);
+                if (m_service.submit(line, reply_to(connection))) {
+                    read(connection);
+                } else {
+                    stop_accepting();
+                }
+            });
+    }
+
+    ReplyFn reply_to(const std::shared_ptr<Connection>& connection) {
+        boost::asio::io_context& io = m_io;
+        return [&io, connection](const std::string& line) {
+            boost::asio::post(io, [connection, text = line + "\n"] {
+                boost::system::error_code ec;
+                boost::asio::write(connection->socket, boost::asio::buffer(text), ec); // 客户端已断开时忽略
+            });
+        };
+    }
+
+    ExportService& m_service;
+    boost::asio::io_context& m_io;
+    stream_protocol::acceptor m_acceptor;
+    std::set<std::shared_ptr<Connection>> m_connections;
+};
+
+int serve_socket(ExportService& service, const std::string& path) {
+    boost::asio::io_context io;
+    SocketServer server(service, io);
+    if (!server.listen(path)) {
+        return 1;
+    }
+    std::cout << "服务已启动，监听本地套接字: " << path << std::endl;
+
+    auto guard = boost::asio::make_work_guard(io); // 作业结束前回复仍需 I/O 线程写出
+    std::thread ioThread([&] { io.run(); });
+
+    service.wait_quit();
+    boost::asio::post(io, [&] { server.stop_accepting(); });
+    service.finish();
+    // 排在所有回复之后执行，关闭连接后 I/O 线程没有剩余的操作，随即结束
+    boost::asio::post(io, [&] { server.close_connections(); });
+    guard.reset();
+    ioThread.join();
+
+    boost::system::error_code ec;
+    fs::remove(path, ec);
+    return 0;
+}
+
+#endif
+
+} // namespace
+
+int run_export_tool(int argc, char* argv[], const po::options_description& desc, const ExportJob& job) {
+    po::variables_map vm;
+    ExportOptions options;
+    int exitCode = 0;
+    if (!parse_export_options(argc, argv, desc, vm, options, exitCode)) {
+        return exitCode;
+    }
+    if (!options.serve) {
+        return job(vm, options);
+    }
+
+    init_gdal(); // 只初始化一次，之后的作业直接使用
+    std::mutex outMutex;
+    JobLogBuffer out(std::cout, outMutex);
+    JobLogBuffer err(std::cerr, outMutex);
+    ExportService service(desc, job, options.serveJobs);
+    if (options.socketPath.empty()) {
+        return serve_stdin(service);
+    }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    return serve_socket(service, options.socketPath);
+#else
+    std::cerr << "错误: 当前平台不支持本地套接字，请从标准输入提交作业" << std::endl;
+    return 1;
+#endif
+}
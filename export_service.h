@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+
+#include <boost/program_options.hpp>
+
+#include "export_app.h"
+
+/**
+ * @brief 工具的一次导出：按解析后的命令行创建提取规则并调用 run_export
+ *
+ * @return 退出码
+ */
+using ExportJob =
+    std::function<int(const boost::program_options::variables_map& vm, const ExportOptions& options)>;
+
+/**
+ * @brief 导出工具的入口：解析命令行后执行一次导出，或者按 --serve 进入服务模式
+ *
+ * 服务模式用于需要频繁导出不同区域的场合。进程只初始化一次 GDAL，S57 驱动
+ * 第一次打开图幅时读入的物标类、属性表在之后的作业中保持加载；使用同一个
+ * --catalog 文件的作业共用内存中的图幅目录，不再每次重新读取 (几何缓存按
+ * 图幅映射到内存，由操作系统的页缓存保持)。
+ *
+ * 作业从标准输入或 --socket 指定的本地套接字逐行读取，每行是一组本工具的
+ * 参数 (不含程序名，按 shell 规则分词)，例如
+ * `-i /data/enc/east -o /data/out/east --bbox 120,30,122,32 --catalog /data/enc.catalog`。
+ * 作业进入队列，由 --serve-jobs 个作业线程按顺序领取执行；作业的日志仍输出到
+ * 服务的标准输出，每行以 `[<序号>] ` 开头、整行写出，结束时向提交它的一方回复
+ * 一行 `作业 <序号> 结束: 退出码 <n>`。
+ * 输出目录或几何缓存目录与先提交的作业重叠的作业，等那个作业结束后再开始。
+ * 一行 `quit` 表示不再接收作业，已收到的作业执行完毕后退出。
+ *
+ * @return 进程退出码
+ */
+int run_export_tool(int argc, char* argv[], const boost::program_options::options_description& desc,
+                    const ExportJob& job);
@@ -0,0 +1,256 @@
+#include "extraction_rules.h"
+
+#include <algorithm>
+
+
+#include "ogrsf_frmts.h"
+
+#include "cell_scanner.h"
+
+namespace po = boost::program_options;
+
+namespace {
+
+// 等价于 WHERE "field" IS NOT NULL AND "field" != ''
+//
+// 字段序号和类型在绑定图层时确定。只有字符串字段可能是 ''；数值字段转换成的
+// 字符串不会为空，只需检查是否为 NULL，不必为每个要素格式化一次数值。
+struct NonEmptyField {
+    int index;
+    bool textual;
+
+    bool test(const OGRFeature& feature) const {
+        return feature.IsFieldSetAndNotNull(index) && (!textual || *feature.GetFieldAsString(index) != '\0');
+    }
+};
+
+NonEmptyField non_empty_field(OGRLayer& layer, int fieldIndex) {
+    return NonEmptyField{fieldIndex, layer.GetLayerDefn()->GetFieldDefn(fieldIndex)->GetType() == OFTString};
+}
+
+class LandExtractor : public LayerExtractor {
+public:
+    explicit LandExtractor(std::string layerName) : m_layerName(std::move(layerName)) {}
+
+    bool accept(const OGRFeature&) const override { return true; }
+
+    void encode(const OGRFeature&, RowEncoder& encoder, std::string& out) const override {
+        encoder.add_string(out, m_layerName.c_str());
+        encoder.add_real(out, -1.0);
+    }
+
+private:
+    std::string m_layerName;
+};
+
+class DepthExtractor : public LayerExtractor {
+public:
+    DepthExtractor(std::string layerName, NonEmptyField field) : m_layerName(std::move(layerName)), m_field(field) {}
+
+    bool accept(const OGRFeature& feature) const override {
+        return m_field.test(feature);
+    }
+
+    void encode(const OGRFeature& feature, RowEncoder& encoder, std::string& out) const override {
+        encoder.add_string(out, m_layerName.c_str());
+        encoder.add_real(out, feature.GetFieldAsDouble(m_field.index));
+    }
+
+private:
+    std::string m_layerName;
+    NonEmptyField m_field;
+};
+
+// SOUNDG 多点要素：每个测深点输出一行，水深取点的 Z 值 (与 ADD_SOUNDG_DEPTH=ON 生成的 DEPTH 相同)
+class SoundingExtractor : public LayerExtractor {
+public:
+    explicit SoundingExtractor(std::string layerName) : m_layerName(std::move(layerName)) {}
+
+    bool accept(const OGRFeature&) const override { return true; }
+
+    void encode(const OGRFeature&, RowEncoder&, std::string&) const override {}
+
+    bool explode_points() const override { return true; }
+
+    void encode_point(const OGRFeature&, double z, RowEncoder& encoder, std::string& out) const override {
+        encoder.add_string(out, m_layerName.c_str());
+        encoder.add_real(out, z);
+    }
+
+private:
+    std::string m_layerName;
+};
+
+class FieldFilterExtractor : public LayerExtractor {
+public:
+    FieldFilterExtractor(std::string level, std::string layerName, NonEmptyField field)
+        : m_level(std::move(level)), m_layerName(std::move(layerName)), m_field(field) {}
+
+    bool accept(const OGRFeature& feature) const override {
+        return m_field.test(feature);
+    }
+
+    void encode(const OGRFeature& feature, RowEncoder& encoder, std::string& out) const override {
+        encoder.add_string(out, m_level.c_str(), false); // 等级不参与去重：不同等级图幅中的同一要素只保留一个
+        encoder.add_string(out, m_layerName.c_str());
+        encoder.add_string(out, feature.GetFieldAsString(m_field.index));
+    }
+
+private:
+    std::string m_level;
+    std::string m_layerName;
+    NonEmptyField m_field;
+};
+
+} // namespace
+
+std::vector<std::string> ExtractionRules::open_options() const {
+    return {"UPDATES=APPLY"}; // 应用同目录下的 .001、.002 … 更新文件 (驱动默认行为，这里显式指定)
+}
+
+bool ExtractionRules::tolerates_open_option(const std::string& /*option*/) const {
+    return false;
+}
+
+std::string ExtractionRules::csv_header() const {
+    std::string header = "WKT";
+    for (const OutputField& field : fields()) {
+        header += "," + field.name;
+    }
+    return header + "\n";
+}
+
+DepthRules::DepthRules(std::map<std::string, std::string> depthFields, std::string landLayer)
+    : m_depthFields(std::move(depthFields)), m_landLayer(std::move(landLayer)) {
+    if (!m_landLayer.empty()) {
+        m_layers.push_back(m_landLayer);
+    }
+    for (const auto& pair : m_depthFields) {
+        m_layers.push_back(pair.first);
+    }
+}
+
+std::map<std::string, std::string> DepthRules::default_depth_fields() {
+    return {
+        {"SOUNDG", "DEPTH"},  // 特殊：由 ADD_SOUNDG_DEPTH=ON 生成
+        {"DEPARE", "DRVAL1"},
+        {"DRGARE", "DRVAL1"},
+        {"DEPCNT", "VALDCO"},
+        {"WRECKS", "VALSOU"},
+        {"OBSTRN", "VALSOU"},
+        {"UWTROC", "VALSOU"}
+    };
+}
+
+bool DepthRules::bulk_soundings() const {
+    auto it = m_depthFields.find("SOUNDG");
+    return it != m_depthFields.end() && it->second == "DEPTH";
+}
+
+std::vector<std::string> DepthRules::open_options() const {
+    std::vector<std::string> options = ExtractionRules::open_options();
+    if (!bulk_soundings()) {
+        options.push_back("SPLIT_MULTIPOINT=ON");
+        options.push_back("ADD_SOUNDG_DEPTH=ON");
+    }
+    return options;
+}
+
+std::vector<OutputField> DepthRules::fields() const {
+    return {{"LAYERS", OutputField::String}, {"DEPTH", OutputField::Real}};
+}
+
+std::string DepthRules::signature() const {
+    std::string signature = "depth";
+    for (const auto& layerName : m_layers) {
+        auto it = m_depthFields.find(layerName);
+        signature += ";" + layerName + "=" + (it != m_depthFields.end() ? it->second : "-1");
+    }
+    return signature;
+}
+
+std::unique_ptr<LayerExtractor> DepthRules::bind(OGRLayer& layer, const std::string& layerName,
+                                                 const S57Cell& /*cell*/, std::ostream& log) const {
+    if (layerName == m_landLayer) {
+        log << "  - 发现陆地区域: '" << layerName << "', 设置深度为 -1" << std::endl;
+        return std::make_unique<LandExtractor>(layerName);
+    }
+    auto it = m_depthFields.find(layerName);
+    if (it == m_depthFields.end()) {
+        return nullptr;
+    }
+    const std::string& depthField = it->second;
+    log << "  - 发现深度图层: '" << layerName << "', 使用字段 '" << depthField << "'" << std::endl;
+    if (layerName == "SOUNDG" && bulk_soundings()) {
+        return std::make_unique<SoundingExtractor>(layerName);
+    }
+
+    const int fieldIndex = layer.GetLayerDefn()->GetFieldIndex(depthField.c_str());
+    if (fieldIndex < 0) {
+        return nullptr; // 字段不存在时所有要素都是 NULL，等价于被 WHERE 过滤掉
+    }
+    return std::make_unique<DepthExtractor>(layerName, non_empty_field(layer, fieldIndex));
+}
+
+void DepthRules::log_summary(bool found, std::ostream& log) const {
+    if (found) {
+        log << "  - 正在导出为 2D CSV..." << std::endl;
+    } else {
+        log << "  - 未发现任何有效目标图层，跳过此文件。" << std::endl;
+    }
+}
+
+FieldFilterRules::FieldFilterRules(std::vector<std::string> layers, std::string filterField)
+    : m_layers(std::move(layers)), m_filterField(std::move(filterField)) {}
+
+void FieldFilterRules::add_options(po::options_description& desc) {
+    desc.add_options()
+        ("layers,l", po::value<std::vector<std::string>>()->multitoken()->default_value({"LNDARE", "DEPARE", "SEAARE", "HRBFAC", "BRIDGE"}, "LNDARE DEPARE..."), "要处理的图层列表")
+        ("field,f", po::value<std::string>()->default_value("NOBJNM"), "要筛选的字段名");
+}
+
+FieldFilterRules FieldFilterRules::from_options(const po::variables_map& vm) {
+    return FieldFilterRules(vm["layers"].as<std::vector<std::string>>(), vm["field"].as<std::string>());
+}
+
+bool FieldFilterRules::tolerates_open_option(const std::string& option) const {
+    // 这两个选项只改变 SOUNDG 图层 (拆分多点、附加水深)，不读取 SOUNDG 时没有影响
+    if (option == "SPLIT_MULTIPOINT=ON" || option == "ADD_SOUNDG_DEPTH=ON") {
+        return std::find(m_layers.begin(), m_layers.end(), "SOUNDG") == m_layers.end();
+    }
+    return false;
+}
+
+std::vector<OutputField> FieldFilterRules::fields() const {
+    return {{"LEVEL", OutputField::String}, {"LAYERS", OutputField::String}, {m_filterField, OutputField::String}};
+}
+
+std::string FieldFilterRules::signature() const {
+    std::string signature = "nobjnm;" + m_filterField;
+    for (const auto& layerName : m_layers) {
+        signature += ";" + layerName;
+    }
+    return signature;
+}
+
+std::unique_ptr<LayerExtractor> FieldFilterRules::bind(OGRLayer& layer, const std::string& layerName,
+                                                       const S57Cell& cell, std::ostream& log) const {
+    const int fieldIndex = layer.GetLayerDefn()->GetFieldIndex(m_filterField.c_str());
+    if (fieldIndex == -1) {
+        log << "  - 发现图层: '" << layerName << "', 但不包含 '" << m_filterField << "' 字段，跳过" << std::endl;
+        return nullptr;
+    }
+    log << "  - 发现图层: '" << layerName << "', 包含 '" << m_filterField << "' 字段，将应用过滤器" << std::endl;
+
+    // 从文件名提取地图等级
+    return std::make_unique<FieldFilterExtractor>(std::string(1, cell_level(cell)), layerName,
+                                                  non_empty_field(layer, fieldIndex));
+}
+
+void FieldFilterRules::log_summary(bool found, std::ostream& log) const {
+    if (found) {
+        log << "  - 正在导出为 CSV..." << std::endl;
+    } else {
+        log << "  - 未发现任何包含 '" << m_filterField << "' 的目标图层，跳过此文件。" << std::endl;
+    }
+}
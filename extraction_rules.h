@@ -0,0 +1,179 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "row_encoder.h"
+
+class OGRFeature;
+class OGRLayer;
+struct S57Cell;
+
+/**
+ * @brief 一个目标图层在某个图幅中的提取器，由 ExtractionRules::bind 创建
+ */
+class LayerExtractor {
+public:
+    virtual ~LayerExtractor() = default;
+
+    /**
+     * @brief 属性过滤，等价于 SQL 中的 WHERE 子句；在几何处理之前调用
+     */
+    virtual bool accept(const OGRFeature& feature) const = 0;
+
+    /**
+     * @brief 输出一行中几何列之后的字段，顺序与 ExtractionRules::fields() 一致
+     */
+    virtual void encode(const OGRFeature& feature, RowEncoder& encoder, std::string& out) const = 0;
+
+    /**
+     * @brief 是否把点或多点要素的每个点单独输出为一行
+     *
+     * 为 true 时不再调用 encode()，也跳过逐要素的简化与修复 (对点没有作用)：
+     * 每个点直接由坐标生成一行，几何列之后的字段由 encode_point() 输出。
+     */
+    virtual bool explode_points() const { return false; }
+
+    /**
+     * @brief explode_points() 为 true 时输出一个点的字段
+     * @param z 点的 Z 值 (SOUNDG 中即水深)
+     */
+    virtual void encode_point(const OGRFeature& /*feature*/, double /*z*/, RowEncoder& /*encoder*/,
+                              std::string& /*out*/) const {}
+};
+
+/**
+ * @brief 一次导出的提取规则：读哪些图层、怎样过滤要素、输出哪些列
+ *
+ * 规则本身不持有图幅状态，可以被多个工作线程同时使用。
+ */
+class ExtractionRules {
+public:
+    virtual ~ExtractionRules() = default;
+
+    /**
+     * @brief 按输出顺序排列的目标图层
+     */
+    virtual const std::vector<std::string>& layers() const = 0;
+
+    /**
+     * @brief 打开图幅时传给 S57 驱动的打开选项
+     */
+    virtual std::vector<std::string> open_options() const;
+
+    /**
+     * @brief 与其他规则共用同一次打开时，能否接受 open_options() 之外的打开选项
+     *
+     * 能接受时两组规则可以共用一个 GDALDataset，否则各自打开图幅。
+     */
+    virtual bool tolerates_open_option(const std::string& option) const;
+
+    /**
+     * @brief 几何列之后的输出列
+     */
+    virtual std::vector<OutputField> fields() const = 0;
+
+    /**
+     * @brief 是否把几何降为二维 (等价于 ogr2ogr -dim 2)
+     */
+    virtual bool flatten() const { return false; }
+
+    /**
+     * @brief 规则的签名，用于增量缓存：规则变化时缓存失效
+     */
+    virtual std::string signature() const = 0;
+
+    /**
+     * @brief 为图幅中的一个目标图层创建提取器
+     * @return nullptr 表示跳过该图层 (例如缺少所需字段)
+     */
+    virtual std::unique_ptr<LayerExtractor> bind(OGRLayer& layer, const std::string& layerName,
+                                                 const S57Cell& cell, std::ostream& log) const = 0;
+
+    /**
+     * @brief 图幅处理完后的日志
+     * @param found 是否有至少一个图层被提取
+     */
+    virtual void log_summary(bool found, std::ostream& log) const = 0;
+
+    /**
+     * @brief CSV 表头行 (含换行符)，由 "WKT" 和 fields() 组成
+     */
+    std::string csv_header() const;
+};
+
+/**
+ * @brief 水深导出规则：图层到深度字段的映射，外加深度固定为 -1 的陆地图层
+ *
+ * 输出列为 LAYERS、DEPTH；深度字段为空的要素被过滤掉。
+ *
+ * SOUNDG 使用 DEPTH 字段时不依赖驱动的 SPLIT_MULTIPOINT/ADD_SOUNDG_DEPTH：
+ * 多点要素按原样读取，每个测深点连同其 Z 值 (水深) 直接输出为一行，结果
+ * 与驱动拆分后逐要素导出相同，但不必为每个测深点创建一个 OGRFeature。
+ */
+class DepthRules : public ExtractionRules {
+public:
+    /**
+     * @param depthFields 图层名到深度字段名的映射
+     * @param landLayer 陆地图层名 (为空表示不导出陆地)
+     */
+    DepthRules(std::map<std::string, std::string> depthFields, std::string landLayer);
+
+    /**
+     * @brief 默认的图层到深度字段的映射 (与 export_depth.sh 一致)
+     */
+    static std::map<std::string, std::string> default_depth_fields();
+
+    const std::vector<std::string>& layers() const override { return m_layers; }
+    std::vector<std::string> open_options() const override;
+    std::vector<OutputField> fields() const override;
+    bool flatten() const override { return true; }
+    std::string signature() const override;
+    std::unique_ptr<LayerExtractor> bind(OGRLayer& layer, const std::string& layerName,
+                                         const S57Cell& cell, std::ostream& log) const override;
+    void log_summary(bool found, std::ostream& log) const override;
+
+private:
+    bool bulk_soundings() const;
+
+    std::map<std::string, std::string> m_depthFields;
+    std::string m_landLayer;
+    std::vector<std::string> m_layers;
+};
+
+/**
+ * @brief 按字段筛选的导出规则：一组图层中指定字段非空的要素
+ *
+ * 输出列为 LEVEL (图幅文件名的第 3 个字符，即航行用途等级)、LAYERS 和筛选字段本身。
+ */
+class FieldFilterRules : public ExtractionRules {
+public:
+    FieldFilterRules(std::vector<std::string> layers, std::string filterField);
+
+    /**
+     * @brief --layers 与 --field 选项，默认值与 export_nobjnm.sh 一致
+     */
+    static void add_options(boost::program_options::options_description& desc);
+
+    /**
+     * @brief 由 add_options() 注册的选项构造规则
+     */
+    static FieldFilterRules from_options(const boost::program_options::variables_map& vm);
+
+    const std::vector<std::string>& layers() const override { return m_layers; }
+    bool tolerates_open_option(const std::string& option) const override;
+    std::vector<OutputField> fields() const override;
+    std::string signature() const override;
+    std::unique_ptr<LayerExtractor> bind(OGRLayer& layer, const std::string& layerName,
+                                         const S57Cell& cell, std::ostream& log) const override;
+    void log_summary(bool found, std::ostream& log) const override;
+
+private:
+    std::vector<std::string> m_layers;
+    std::string m_filterField;
+};
@@ -0,0 +1,181 @@
+#include "geometry_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "cell_scanner.h"
+#include "cell_stats.h"
+#include "geometry_stage.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+constexpr char kMagic[8] = {'S', '5', '7', 'G', 'E', 'O', 'M', '2'};
+
+constexpr std::uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+std::uint64_t fnv1a(const char* data, std::size_t size) {
+    std::uint64_t hash = kFnvOffset;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+bool is_point(const OGRGeometry& geom) {
+    const OGRwkbGeometryType type = wkbFlatten(geom.getGeometryType());
+    return type == wkbPoint || type == wkbMultiPoint;
+}
+
+} // namespace
+
+struct CellGeometryCache::Mapping {
+    boost::iostreams::mapped_file_source file;
+};
+
+CellGeometryCache::CellGeometryCache(const std::string& cacheDir, const S57Cell& cell) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.geom",
+                  static_cast<unsigned long long>(fnv1a(cell.path.data(), cell.path.size())));
+    m_path = (fs::path(cacheDir) / name).string();
+
+    boost::system::error_code ec;
+    if (fs::file_size(m_path, ec) < sizeof(kMagic) + sizeof(std::uint64_t) || ec) {
+        return;
+    }
+    try {
+        m_mapping = std::make_unique<Mapping>();
+        m_mapping->file.open(m_path);
+    } catch (const std::exception&) {
+        m_mapping.reset();
+        return;
+    }
+
+    const char* data = m_mapping->file.data();
+    const std::size_t size = m_mapping->file.size();
+    std::uint64_t count = 0;
+    std::memcpy(&count, data + sizeof(kMagic), sizeof(count));
+    const std::size_t indexEnd = sizeof(kMagic) + sizeof(count) + count * sizeof(Entry);
+    if (std::memcmp(data, kMagic, sizeof(kMagic)) != 0 || count > size / sizeof(Entry) || indexEnd > size) {
+        m_mapping.reset(); // 格式不对，当作没有缓存
+        return;
+    }
+    m_entries = reinterpret_cast<const Entry*>(data + sizeof(kMagic) + sizeof(count));
+    m_count = static_cast<std::size_t>(count);
+    m_blob = data + indexEnd;
+    m_blobSize = size - indexEnd;
+}
+
+CellGeometryCache::~CellGeometryCache() = default;
+
+const CellGeometryCache::Entry* CellGeometryCache::find(std::uint64_t layerHash, std::int64_t rcid) const {
+    const Entry* end = m_entries + m_count;
+    const Entry* it = std::lower_bound(m_entries, end, std::make_tuple(layerHash, rcid),
+                                       [](const Entry& e, const std::tuple<std::uint64_t, std::int64_t>& key) {
+                                           return std::make_tuple(e.layerHash, e.rcid) < key;
+                                       });
+    if (it != end && it->layerHash == layerHash && it->rcid == rcid) {
+        return it;
+    }
+    return nullptr;
+}
+
+OGRGeometryUniquePtr CellGeometryCache::simplify_and_make_valid(const std::string& layerName, std::int64_t rcid,
+                                                                const OGRGeometry* poGeom, double tolerance,
+                                                                CellStats* stats, double grid) {
+    if (!poGeom || rcid < 0 || is_point(*poGeom)) {
+        return ::simplify_and_make_valid(poGeom, tolerance, stats, grid);
+    }
+
+    // 源几何的哈希：驱动应用更新后几何变化的要素会得到不同的哈希
+    m_wkb.resize(poGeom->WkbSize());
+    poGeom->exportToWkb(wkbNDR, reinterpret_cast<unsigned char*>(&m_wkb[0]), wkbVariantIso);
+    const std::uint64_t sourceHash = fnv1a(m_wkb.data(), m_wkb.size());
+    const std::uint64_t layerHash = fnv1a(layerName.data(), layerName.size());
+
+    Entry entry{layerHash, rcid, sourceHash, tolerance, grid, m_newBlob.size(), 0};
+    const Entry* cached = find(layerHash, rcid);
+    if (cached && cached->sourceHash == sourceHash && cached->tolerance == tolerance && cached->grid == grid &&
+        cached->offset <= m_blobSize && cached->size <= m_blobSize - cached->offset) {
+        StageTimer timer(stats, Stage::Simplify);
+        OGRGeometry* geom = nullptr;
+        if (cached->size == 0 ||
+            OGRGeometryFactory::createFromWkb(m_blob + cached->offset, nullptr, &geom,
+                                              static_cast<std::size_t>(cached->size), wkbVariantIso) == OGRERR_NONE) {
+            ++m_hits;
+            entry.size = cached->size;
+            m_newBlob.append(m_blob + cached->offset, static_cast<std::size_t>(cached->size));
+            m_newEntries.push_back(entry);
+            return OGRGeometryUniquePtr(geom);
+        }
+    }
+
+    ++m_misses;
+    OGRGeometryUniquePtr result = ::simplify_and_make_valid(poGeom, tolerance, stats, grid);
+    if (result) {
+        entry.size = result->WkbSize();
+        const std::size_t offset = m_newBlob.size();
+        m_newBlob.resize(offset + static_cast<std::size_t>(entry.size));
+        result->exportToWkb(wkbNDR, reinterpret_cast<unsigned char*>(&m_newBlob[offset]), wkbVariantIso);
+    }
+    m_newEntries.push_back(entry);
+    return result;
+}
+
+bool CellGeometryCache::save() {
+    if (m_misses == 0 && m_newEntries.size() == m_count) {
+        return true; // 全部命中且没有删除的要素，旧文件仍然有效
+    }
+
+    std::sort(m_newEntries.begin(), m_newEntries.end(), [](const Entry& a, const Entry& b) {
+        return std::make_tuple(a.layerHash, a.rcid) < std::make_tuple(b.layerHash, b.rcid);
+    });
+    // 同一个键出现多次 (例如同一图层被多个规则集分别打开) 时只保留一条
+    m_newEntries.erase(std::unique(m_newEntries.begin(), m_newEntries.end(),
+                                   [](const Entry& a, const Entry& b) {
+                                       return a.layerHash == b.layerHash && a.rcid == b.rcid;
+                                   }),
+                       m_newEntries.end());
+
+    boost::system::error_code ec;
+    fs::create_directories(fs::path(m_path).parent_path(), ec);
+    // 服务模式下多个作业可能同时保存同一个图幅的缓存，每次写入使用不同的临时文件，改名是原子的
+    const std::string tmpPath = fs::unique_path(m_path + ".%%%%-%%%%-%%%%.tmp").string();
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        const std::uint64_t count = m_newEntries.size();
+        out.write(kMagic, sizeof(kMagic));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(m_newEntries.data()),
+                  static_cast<std::streamsize>(m_newEntries.size() * sizeof(Entry)));
+        out.write(m_newBlob.data(), static_cast<std::streamsize>(m_newBlob.size()));
+        if (!out) {
+            std::cerr << "警告: 无法写入几何缓存 " << tmpPath << std::endl;
+            out.close();
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    m_mapping.reset(); // Windows 下映射中的文件不能被替换
+    m_entries = nullptr;
+    m_count = 0;
+    m_blob = nullptr;
+    m_blobSize = 0;
+    fs::rename(tmpPath, m_path, ec);
+    if (ec) {
+        std::cerr << "警告: 无法更新几何缓存 " << m_path << ": " << ec.message() << std::endl;
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ogr_geometry.h"
+
+struct CellStats;
+struct S57Cell;
+
+/**
+ * @brief 单个图幅的几何缓存：保存简化 + 修复后的几何 (WKB)，下次运行时直接读取
+ *
+ * 缓存目录下每个图幅一个文件，键为 (图层, 要素 RCID, 容差, 量化网格)，并记录源几何
+ * WKB 的哈希：应用了新的更新文件后，只有几何确实变化的要素需要重新经过
+ * GEOS 处理，其余要素直接从内存映射的缓存文件构造结果。
+ *
+ * 只缓存线和面；点的简化几乎没有开销，而且 SPLIT_MULTIPOINT 会让多个
+ * 要素共用一个 RCID。每个图幅只由一个工作线程处理，因此不需要加锁。
+ * save() 只保留本次用到的条目，已删除的要素随之清理。
+ */
+class CellGeometryCache {
+public:
+    /**
+     * @param cacheDir 缓存目录
+     * @param cell 图幅
+     */
+    CellGeometryCache(const std::string& cacheDir, const S57Cell& cell);
+    ~CellGeometryCache();
+
+    CellGeometryCache(const CellGeometryCache&) = delete;
+    CellGeometryCache& operator=(const CellGeometryCache&) = delete;
+
+    /**
+     * @brief 带缓存的 simplify_and_make_valid
+     *
+     * @param rcid 要素的 RCID，< 0 表示没有 RCID (不使用缓存)
+     * @param stats 不为空时累计耗时；命中缓存时读取几何的耗时计入简化阶段
+     */
+    OGRGeometryUniquePtr simplify_and_make_valid(const std::string& layerName, std::int64_t rcid,
+                                                 const OGRGeometry* poGeom, double tolerance,
+                                                 CellStats* stats = nullptr, double grid = 0);
+
+    /**
+     * @brief 写出本图幅的新缓存文件 (没有变化时不写)
+     * @return false 如果写入失败
+     */
+    bool save();
+
+    std::size_t hits() const { return m_hits; }
+    std::size_t misses() const { return m_misses; }
+
+private:
+    struct Entry {
+        std::uint64_t layerHash;
+        std::int64_t rcid;
+        std::uint64_t sourceHash;
+        double tolerance;
+        double grid;
+        std::uint64_t offset;
+        std::uint64_t size; // 0 表示处理结果为空 (NULL)
+    };
+
+    const Entry* find(std::uint64_t layerHash, std::int64_t rcid) const;
+
+    struct Mapping;
+
+    std::string m_path;
+    std::unique_ptr<Mapping> m_mapping; // 上一次的缓存文件
+    const Entry* m_entries = nullptr;
+    std::size_t m_count = 0;
+    const char* m_blob = nullptr;
+    std::size_t m_blobSize = 0;
+
+    std::vector<Entry> m_newEntries; // 本次用到的条目，offset 指向 m_newBlob
+    std::string m_newBlob;
+    std::string m_wkb; // 源几何 WKB 的复用缓冲区
+    std::size_t m_hits = 0;
+    std::size_t m_misses = 0;
+};
@@ -0,0 +1,151 @@
+#include "geometry_stage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "cell_pipeline.h"
+#include "cell_stats.h"
+#include "coord_kernel.h"
+#include "csv_format.h"
+#include "geometry_validity.h"
+
+ToleranceTable::ToleranceTable() : m_levels{0.0025, 0.001, 0.0005, 0.00025, 0.0001, 0.00005}, m_fallback(0.00025) {}
+
+bool ToleranceTable::set(char level, double tolerance) {
+    if (level < '1' || level > '6') {
+        return false;
+    }
+    m_levels[level - '1'] = tolerance;
+    return true;
+}
+
+void ToleranceTable::set_all(double tolerance) {
+    std::fill(std::begin(m_levels), std::end(m_levels), tolerance);
+    m_fallback = tolerance;
+}
+
+double ToleranceTable::get(char level) const {
+    if (level < '1' || level > '6') {
+        return m_fallback;
+    }
+    return m_levels[level - '1'];
+}
+
+std::string ToleranceTable::signature() const {
+    std::string signature;
+    for (char level = '1'; level <= '6'; ++level) {
+        signature += level;
+        signature += ':';
+        append_csv_real(signature, get(level));
+        signature += ',';
+    }
+    signature += "*:";
+    append_csv_real(signature, m_fallback);
+    return signature;
+}
+
+OGRGeometryUniquePtr simplify_and_make_valid(const OGRGeometry* poGeom, double tolerance, CellStats* stats,
+                                             double grid) {
+    if (!poGeom) {
+        return nullptr;
+    }
+
+    OGRGeometryUniquePtr poSimplified;
+    {
+        StageTimer timer(stats, Stage::Simplify);
+        poSimplified.reset(poGeom->SimplifyPreserveTopology(tolerance));
+    }
+    return quantize_and_make_valid(std::move(poSimplified), stats, grid);
+}
+
+OGRGeometryUniquePtr quantize_and_make_valid(OGRGeometryUniquePtr poSimplified, CellStats* stats, double grid) {
+    if (!poSimplified) {
+        return nullptr;
+    }
+    if (grid > 0) {
+        StageTimer timer(stats, Stage::Quantize);
+        quantize_geometry(*poSimplified, grid);
+    }
+
+    // 简化后的几何大多已经有效，MakeValid 对有效几何原样返回，因此先做快速检查
+    bool valid;
+    {
+        StageTimer timer(stats, Stage::Precheck);
+        valid = is_known_valid(*poSimplified);
+    }
+    if (stats) {
+        ++(valid ? stats->valid : stats->makeValidCalls);
+    }
+    if (valid) {
+        return poSimplified;
+    }
+
+    StageTimer timer(stats, Stage::MakeValid);
+    return OGRGeometryUniquePtr(poSimplified->MakeValid());
+}
+
+std::size_t count_vertices(const OGRGeometry* poGeom) {
+    if (!poGeom || poGeom->IsEmpty()) {
+        return 0;
+    }
+    switch (wkbFlatten(poGeom->getGeometryType())) {
+    case wkbPoint:
+        return 1;
+    case wkbLineString:
+    case wkbLinearRing:
+        return static_cast<std::size_t>(poGeom->toSimpleCurve()->getNumPoints());
+    case wkbPolygon: {
+        const OGRPolygon* poPoly = poGeom->toPolygon();
+        std::size_t count = count_vertices(poPoly->getExteriorRing());
+        for (int i = 0; i < poPoly->getNumInteriorRings(); ++i) {
+            count += count_vertices(poPoly->getInteriorRing(i));
+        }
+        return count;
+    }
+    case wkbMultiPoint:
+    case wkbMultiLineString:
+    case wkbMultiPolygon:
+    case wkbGeometryCollection: {
+        const OGRGeometryCollection* poColl = poGeom->toGeometryCollection();
+        std::size_t count = 0;
+        for (int i = 0; i < poColl->getNumGeometries(); ++i) {
+            count += count_vertices(poColl->getGeometryRef(i));
+        }
+        return count;
+    }
+    default:
+        return 0;
+    }
+}
+
+namespace {
+
+void assign_envelope_tile(RowInfo& tile, double minX, double minY, double maxX, double maxY, double tileSize) {
+    tile.minX = minX;
+    tile.minY = minY;
+    tile.maxX = maxX;
+    tile.maxY = maxY;
+
+    // 以外包矩形中心定网格，每行只属于一个分片；超出经纬度范围的坐标归入边缘网格
+    const double maxColumn = std::ceil(360.0 / tileSize) - 1;
+    const double maxRow = std::ceil(180.0 / tileSize) - 1;
+    const double column = std::floor(((minX + maxX) / 2 + 180.0) / tileSize);
+    const double row = std::floor(((minY + maxY) / 2 + 90.0) / tileSize);
+    tile.column = static_cast<std::int32_t>(std::min(std::max(column, 0.0), maxColumn));
+    tile.row = static_cast<std::int32_t>(std::min(std::max(row, 0.0), maxRow));
+}
+
+} // namespace
+
+void assign_row_tile(RowInfo& tile, const OGRGeometry* poGeom, double tileSize) {
+    if (poGeom && !poGeom->IsEmpty()) {
+        OGREnvelope env;
+        poGeom->getEnvelope(&env);
+        assign_envelope_tile(tile, env.MinX, env.MinY, env.MaxX, env.MaxY, tileSize);
+    }
+}
+
+void assign_point_tile(RowInfo& tile, double x, double y, double tileSize) {
+    assign_envelope_tile(tile, x, y, x, y, tileSize);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "ogr_geometry.h"
+
+struct CellStats;
+struct RowInfo;
+
+/**
+ * @brief 按航行用途等级选择简化容差 (度)
+ *
+ * 小比例尺图幅 (总图、概略图) 的要素在下游本来就只在小比例尺下显示，可以
+ * 大幅简化；泊位图等大比例尺图幅则需要保留细节。默认表按等级 1-6 依次为
+ * 0.0025、0.001、0.0005、0.00025、0.0001、0.00005，无法识别的等级使用 0.00025
+ * (即原来固定的容差)。
+ */
+class ToleranceTable {
+public:
+    ToleranceTable();
+
+    /**
+     * @brief 设置某一等级 ('1' - '6') 的容差
+     * @return false 如果等级无效
+     */
+    bool set(char level, double tolerance);
+
+    /**
+     * @brief 所有等级 (包括无法识别的等级) 使用同一容差
+     */
+    void set_all(double tolerance);
+
+    double get(char level) const;
+
+    /**
+     * @brief 容差表的文本形式，用于增量缓存的参数签名
+     */
+    std::string signature() const;
+
+private:
+    double m_levels[6];
+    double m_fallback;
+};
+
+/**
+ * @brief 几何处理阶段，等价于 SQL 中的
+ *        ST_MakeValid(ST_SimplifyPreserveTopology(geometry, tolerance))
+ *
+ * @param poGeom 源几何，可以为 nullptr
+ * @param tolerance 简化容差 (度)
+ * @param stats 不为空时分别累计简化、量化和修复的耗时
+ * @param grid 大于 0 时简化后先把顶点量化到该网格并去掉重复顶点 (见 quantize_geometry)，
+ *             再交给 MakeValid，修复的是实际输出的坐标
+ * @return 处理后的几何；源几何为空或 GEOS 处理失败时返回空指针 (对应 SQL 中的 NULL)
+ */
+OGRGeometryUniquePtr simplify_and_make_valid(const OGRGeometry* poGeom, double tolerance,
+                                             CellStats* stats = nullptr, double grid = 0);
+
+/**
+ * @brief simplify_and_make_valid 在简化之后的部分：按 grid 量化 (grid 为 0 时跳过)，再 MakeValid
+ *
+ * 通过 is_known_valid 快速检查的几何不调用 MakeValid (结果相同)，只有可能
+ * 无效的几何才交给 GEOS 修复。
+ *
+ * 供自行完成简化的调用方使用 (见 SharedEdgeSimplifier)。
+ */
+OGRGeometryUniquePtr quantize_and_make_valid(OGRGeometryUniquePtr poSimplified, CellStats* stats = nullptr,
+                                             double grid = 0);
+
+/**
+ * @brief 几何的顶点数 (集合类型为所有成员之和)，用于统计
+ */
+std::size_t count_vertices(const OGRGeometry* poGeom);
+
+/**
+ * @brief 按几何外包矩形的中心把一行归入经纬度网格，并记录外包矩形
+ *
+ * @param poGeom 该行输出的几何，可以为 nullptr (归入空几何分片)
+ * @param tileSize 网格边长 (度)
+ */
+void assign_row_tile(RowInfo& info, const OGRGeometry* poGeom, double tileSize);
+
+/**
+ * @brief 同 assign_row_tile，用于只有坐标的点
+ */
+void assign_point_tile(RowInfo& info, double x, double y, double tileSize);
@@ -0,0 +1,288 @@
+#include "geometry_validity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
+
+#include "ogr_geometry.h"
+
+namespace {
+
+// 去掉连续重复顶点后的闭合环 (pts.front() == pts.back())
+struct Ring {
+    std::vector<OGRRawPoint> pts;
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+
+    bool envelope_contains(const Ring& other) const {
+        return other.minX >= minX && other.maxX <= maxX && other.minY >= minY && other.maxY <= maxY;
+    }
+};
+
+// 一个面：rings[first] 为外环，其后 holes 个为洞
+struct PolygonRings {
+    std::size_t first;
+    std::size_t holes;
+};
+
+struct Segment {
+    double minX, maxX;
+    std::size_t ring;
+    std::size_t index; // 边的起点在环中的序号
+};
+
+// 扫描线的活动边按外包矩形的最大 x 排列，已离开扫描线的边都在开头
+struct ByMaxX {
+    bool operator()(const Segment* a, const Segment* b) const { return a->maxX < b->maxX; }
+};
+
+bool same_point(const OGRRawPoint& a, const OGRRawPoint& b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+bool finite(const OGRRawPoint& p) {
+    return std::isfinite(p.x) && std::isfinite(p.y);
+}
+
+// c 在有向线段 ab 的左侧 (1)、右侧 (-1)；共线或在舍入误差范围内无法判断时为 0
+int orientation(const OGRRawPoint& a, const OGRRawPoint& b, const OGRRawPoint& c) {
+    const double left = (a.x - c.x) * (b.y - c.y);
+    const double right = (a.y - c.y) * (b.x - c.x);
+    const double det = left - right;
+    const double bound = 1e-12 * (std::fabs(left) + std::fabs(right)); // 远大于 double 行列式的舍入误差
+    if (det > bound) {
+        return 1;
+    }
+    if (det < -bound) {
+        return -1;
+    }
+    return 0;
+}
+
+// 两条边是否可能接触：外包矩形相交且方向判断明确表示互不相交时才返回 false
+bool may_touch(const OGRRawPoint& a, const OGRRawPoint& b, const OGRRawPoint& c, const OGRRawPoint& d) {
+    if (std::max(c.y, d.y) < std::min(a.y, b.y) || std::min(c.y, d.y) > std::max(a.y, b.y)) {
+        return false;
+    }
+    const int o1 = orientation(a, b, c);
+    const int o2 = orientation(a, b, d);
+    const int o3 = orientation(c, d, a);
+    const int o4 = orientation(c, d, b);
+    if (o1 == 0 || o2 == 0 || o3 == 0 || o4 == 0) {
+        return true;
+    }
+    return o1 != o2 && o3 != o4;
+}
+
+bool load_ring(const OGRSimpleCurve& curve, Ring& ring) {
+    const int count = curve.getNumPoints();
+    std::vector<OGRRawPoint> points(count);
+    curve.getPoints(points.data());
+    ring.pts.clear();
+    for (const OGRRawPoint& p : points) {
+        if (!finite(p)) {
+            return false;
+        }
+        if (ring.pts.empty() || !same_point(ring.pts.back(), p)) {
+            ring.pts.push_back(p);
+        }
+    }
+    if (ring.pts.size() < 4 || !same_point(ring.pts.front(), ring.pts.back())) {
+        return false;
+    }
+    ring.minX = ring.maxX = ring.pts[0].x;
+    ring.minY = ring.maxY = ring.pts[0].y;
+    for (const OGRRawPoint& p : ring.pts) {
+        ring.minX = std::min(ring.minX, p.x);
+        ring.maxX = std::max(ring.maxX, p.x);
+        ring.minY = std::min(ring.minY, p.y);
+        ring.maxY = std::max(ring.maxY, p.y);
+    }
+    return true;
+}
+
+// 相邻两条边 ab、bc 不能折返重叠 (尖刺)
+bool no_spikes(const Ring& ring) {
+    const std::size_t n = ring.pts.size() - 1; // 边数
+    for (std::size_t i = 0; i < n; ++i) {
+        const OGRRawPoint& a = ring.pts[i];
+        const OGRRawPoint& b = ring.pts[i + 1];
+        const OGRRawPoint& c = ring.pts[i + 2 <= n ? i + 2 : 1]; // 最后一条边与第一条边相邻
+        if (orientation(a, b, c) == 0 && (a.x - b.x) * (c.x - b.x) + (a.y - b.y) * (c.y - b.y) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool adjacent(const Segment& s, const Segment& t, const std::vector<Ring>& rings) {
+    if (s.ring != t.ring) {
+        return false;
+    }
+    const std::size_t n = rings[s.ring].pts.size() - 1;
+    const std::size_t gap = s.index > t.index ? s.index - t.index : t.index - s.index;
+    return gap == 1 || gap == n - 1;
+}
+
+// 扫描线：边按外包矩形的最小 x 排序，只与 x 区间重叠的活动边比较
+bool rings_disjoint(const std::vector<Ring>& rings) {
+    std::vector<Segment> segments;
+    for (std::size_t r = 0; r < rings.size(); ++r) {
+        const std::vector<OGRRawPoint>& pts = rings[r].pts;
+        for (std::size_t i = 0; i + 1 < pts.size(); ++i) {
+            segments.push_back(Segment{std::min(pts[i].x, pts[i + 1].x), std::max(pts[i].x, pts[i + 1].x), r, i});
+        }
+    }
+    std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) { return a.minX < b.minX; });
+
+    std::multiset<const Segment*, ByMaxX> active;
+    for (const Segment& s : segments) {
+        while (!active.empty() && (*active.begin())->maxX < s.minX) {
+            active.erase(active.begin());
+        }
+        const OGRRawPoint& a = rings[s.ring].pts[s.index];
+        const OGRRawPoint& b = rings[s.ring].pts[s.index + 1];
+        for (const Segment* t : active) {
+            if (adjacent(s, *t, rings)) {
+                continue; // 相邻边共用顶点，折返由 no_spikes 检查
+            }
+            if (may_touch(a, b, rings[t->ring].pts[t->index], rings[t->ring].pts[t->index + 1])) {
+                return false;
+            }
+        }
+        active.insert(&s);
+    }
+    return true;
+}
+
+// 射线法判断点是否在环内；调用前已确认点不在任何边上
+bool inside(const OGRRawPoint& p, const Ring& ring) {
+    bool in = false;
+    for (std::size_t i = 0, j = ring.pts.size() - 2; i + 1 < ring.pts.size(); j = i++) {
+        const OGRRawPoint& a = ring.pts[i];
+        const OGRRawPoint& b = ring.pts[j];
+        if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x) {
+            in = !in;
+        }
+    }
+    return in;
+}
+
+bool load_polygon(const OGRPolygon& polygon, std::vector<Ring>& rings, std::vector<PolygonRings>& polygons) {
+    const OGRLinearRing* shell = polygon.getExteriorRing();
+    if (!shell || polygon.IsEmpty()) {
+        return false;
+    }
+    PolygonRings entry{rings.size(), static_cast<std::size_t>(polygon.getNumInteriorRings())};
+    rings.emplace_back();
+    if (!load_ring(*shell, rings.back())) {
+        return false;
+    }
+    for (int i = 0; i < polygon.getNumInteriorRings(); ++i) {
+        rings.emplace_back();
+        if (!load_ring(*polygon.getInteriorRing(i), rings.back())) {
+            return false;
+        }
+    }
+    polygons.push_back(entry);
+    return true;
+}
+
+// 边界互不接触的前提下，检查洞在外环之内、洞互不嵌套、各个面互不包含
+bool nesting_valid(const std::vector<Ring>& rings, const std::vector<PolygonRings>& polygons) {
+    for (const PolygonRings& polygon : polygons) {
+        const Ring& shell = rings[polygon.first];
+        for (std::size_t h = polygon.first + 1; h <= polygon.first + polygon.holes; ++h) {
+            if (!shell.envelope_contains(rings[h]) || !inside(rings[h].pts[0], shell)) {
+                return false;
+            }
+            for (std::size_t k = polygon.first + 1; k <= polygon.first + polygon.holes; ++k) {
+                if (k != h && rings[k].envelope_contains(rings[h]) && inside(rings[h].pts[0], rings[k])) {
+                    return false;
+                }
+            }
+        }
+    }
+    // 面 p 的外环在面 q 之内 (在 q 的外环内且不在 q 的任何洞内) 时内部重叠
+    for (const PolygonRings& p : polygons) {
+        const Ring& shell = rings[p.first];
+        for (const PolygonRings& q : polygons) {
+            if (&p == &q || !rings[q.first].envelope_contains(shell) || !inside(shell.pts[0], rings[q.first])) {
+                continue;
+            }
+            bool inHole = false;
+            for (std::size_t h = q.first + 1; h <= q.first + q.holes && !inHole; ++h) {
+                inHole = rings[h].envelope_contains(shell) && inside(shell.pts[0], rings[h]);
+            }
+            if (!inHole) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool line_valid(const OGRSimpleCurve& curve) {
+    const int count = curve.getNumPoints();
+    std::vector<OGRRawPoint> points(count);
+    curve.getPoints(points.data());
+    bool distinct = false;
+    for (const OGRRawPoint& p : points) {
+        if (!finite(p)) {
+            return false;
+        }
+        distinct = distinct || !same_point(p, points[0]);
+    }
+    return distinct;
+}
+
+} // namespace
+
+bool is_known_valid(const OGRGeometry& geom) {
+    switch (wkbFlatten(geom.getGeometryType())) {
+    case wkbPoint: {
+        const OGRPoint* point = geom.toPoint();
+        return !point->IsEmpty() && std::isfinite(point->getX()) && std::isfinite(point->getY());
+    }
+    case wkbLineString:
+        return line_valid(*geom.toSimpleCurve());
+    case wkbMultiPoint:
+    case wkbMultiLineString: {
+        const OGRGeometryCollection* poColl = geom.toGeometryCollection();
+        for (int i = 0; i < poColl->getNumGeometries(); ++i) {
+            if (!is_known_valid(*poColl->getGeometryRef(i))) {
+                return false;
+            }
+        }
+        return poColl->getNumGeometries() > 0;
+    }
+    case wkbPolygon:
+    case wkbMultiPolygon: {
+        std::vector<Ring> rings;
+        std::vector<PolygonRings> polygons;
+        if (wkbFlatten(geom.getGeometryType()) == wkbPolygon) {
+            if (!load_polygon(*geom.toPolygon(), rings, polygons)) {
+                return false;
+            }
+        } else {
+            const OGRGeometryCollection* poColl = geom.toGeometryCollection();
+            for (int i = 0; i < poColl->getNumGeometries(); ++i) {
+                if (!load_polygon(*poColl->getGeometryRef(i)->toPolygon(), rings, polygons)) {
+                    return false;
+                }
+            }
+            if (polygons.empty()) {
+                return false;
+            }
+        }
+        for (const Ring& ring : rings) {
+            if (!no_spikes(ring)) {
+                return false;
+            }
+        }
+        return rings_disjoint(rings) && nesting_valid(rings, polygons);
+    }
+    default:
+        return false;
+    }
+}
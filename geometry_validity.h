@@ -0,0 +1,17 @@
+#pragma once
+
+class OGRGeometry;
+
+/**
+ * @brief 保守的快速有效性检查，用于跳过不必要的 MakeValid
+ *
+ * 返回 true 时几何按 OGC 规则 (GEOS IsValidOp) 一定有效，MakeValid 会原样
+ * 返回它，因此可以直接使用；返回 false 只表示不能确定，由 MakeValid 处理。
+ *
+ * 检查的内容：坐标有限；线至少有两个不同的顶点；环闭合且至少有 4 个顶点；
+ * 所有环的边两两之间除相邻边共用的顶点外没有任何接触 (按外包矩形的 x 区间
+ * 扫描，只比较区间重叠的边，方向判断接近共线时按接触处理)；洞在外环之内、
+ * 互不嵌套；多面的各个面互不包含。环的方向不影响有效性，不检查。
+ * 几何集合总是返回 false。
+ */
+bool is_known_valid(const OGRGeometry& geom);
@@ -0,0 +1,325 @@
+#include "incremental_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include "cpl_vsi.h"
+
+#include "cell_pipeline.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+constexpr const char* kManifestMagic = "# s57 export manifest v2";
+
+constexpr std::uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+std::uint64_t fnv1a(const char* data, std::size_t size, std::uint64_t hash = kFnvOffset) {
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+std::string to_hex(std::uint64_t value) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(value));
+    return buf;
+}
+
+// 图幅可能位于压缩包中 (/vsizip/、/vsitar/)，因此通过 GDAL 的虚拟文件系统读取
+bool stat_file(const std::string& path, CellFingerprint& fp) {
+    VSIStatBufL stat;
+    if (VSIStatL(path.c_str(), &stat) != 0) {
+        return false;
+    }
+    fp.size += static_cast<std::uintmax_t>(stat.st_size);
+    fp.mtime = std::max<std::time_t>(fp.mtime, static_cast<std::time_t>(stat.st_mtime));
+    return true;
+}
+
+bool read_file(const std::string& path, std::string& data) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return false;
+    }
+    data.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    return static_cast<bool>(in.read(&data[0], static_cast<std::streamsize>(data.size())));
+}
+
+// 切分或去重时每行的附加信息保存在分片旁的 .rows 文件中，每行一条：
+// 字节数 去重键 列 行 外包矩形
+constexpr const char* kRowInfoSuffix = ".rows";
+
+bool write_row_info(const std::string& path, const std::vector<RowInfo>& rowInfo) {
+    std::string data;
+    char line[192];
+    for (const RowInfo& info : rowInfo) {
+        const int n = std::snprintf(line, sizeof(line), "%zu %llu %d %d %.17g %.17g %.17g %.17g\n", info.size,
+                                    static_cast<unsigned long long>(info.key), info.column, info.row,
+                                    info.minX, info.minY, info.maxX, info.maxY);
+        data.append(line, static_cast<std::size_t>(n));
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+    return static_cast<bool>(out);
+}
+
+bool read_row_info(const std::string& path, std::vector<RowInfo>& rowInfo) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    RowInfo info;
+    unsigned long long key = 0;
+    while (in >> info.size >> key >> info.column >> info.row >> info.minX >> info.minY >> info.maxX >> info.maxY) {
+        info.key = key;
+        rowInfo.push_back(info);
+    }
+    return in.eof();
+}
+
+} // namespace
+
+bool stat_cell(const S57Cell& cell, CellFingerprint& fp) {
+    fp = CellFingerprint();
+    fp.updates = cell.updates.size();
+    if (!stat_file(cell.path, fp)) {
+        return false;
+    }
+    for (const std::string& update : cell.updates) {
+        if (!stat_file(update, fp)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool hash_file(const std::string& path, std::uint64_t& hash) {
+    VSILFILE* file = VSIFOpenL(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<char> buffer(1 << 20);
+    std::size_t n = 0;
+    while ((n = VSIFReadL(buffer.data(), 1, buffer.size(), file)) > 0) {
+        hash = fnv1a(buffer.data(), n, hash);
+    }
+    const bool ok = VSIFEofL(file) != 0; // 未读到文件末尾即读取出错
+    VSIFCloseL(file);
+    return ok;
+}
+
+bool hash_cell(const S57Cell& cell, std::uint64_t& hash) {
+    hash = kFnvOffset;
+    if (!hash_file(cell.path, hash)) {
+        return false;
+    }
+    for (const std::string& update : cell.updates) {
+        if (!hash_file(update, hash)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+IncrementalCache::IncrementalCache(std::string cacheDir, std::string manifestPath, std::string signature)
+    : m_cacheDir(std::move(cacheDir)), m_manifestPath(std::move(manifestPath)), m_signature(std::move(signature)) {}
+
+bool IncrementalCache::hash_current(const S57Cell& cell, Entry& current) {
+    if (!hash_cell(cell, current.fingerprint.hash)) {
+        current = Entry(); // 由 store() 重新读取
+        return false;
+    }
+    return true;
+}
+
+std::string IncrementalCache::shard_path(const std::string& shard) const {
+    return (fs::path(m_cacheDir) / shard).string();
+}
+
+void IncrementalCache::load(std::size_t cellCount) {
+    m_previous.clear();
+    m_current.assign(cellCount, Entry());
+
+    std::ifstream in(m_manifestPath);
+    std::string line;
+    if (!std::getline(in, line) || line != std::string(kManifestMagic) + "\t" + m_signature) {
+        if (in) {
+            std::cout << "导出参数已变化，增量缓存失效，将重新处理所有图幅" << std::endl;
+        }
+        return;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        Entry entry;
+        std::string updates, size, mtime, hash, rows;
+        if (std::getline(fields, entry.path, '\t') && std::getline(fields, updates, '\t') &&
+            std::getline(fields, size, '\t') &&
+            std::getline(fields, mtime, '\t') && std::getline(fields, hash, '\t') &&
+            std::getline(fields, entry.shard, '\t') && std::getline(fields, rows)) {
+            try {
+                entry.fingerprint.updates = std::stoull(updates);
+                entry.fingerprint.size = std::stoull(size);
+                entry.fingerprint.mtime = static_cast<std::time_t>(std::stoll(mtime));
+                entry.fingerprint.hash = std::stoull(hash, nullptr, 16);
+                entry.rows = std::stoull(rows);
+            } catch (const std::exception&) {
+                continue; // 损坏的行忽略，该图幅重新提取
+            }
+            entry.valid = true;
+            m_previous.emplace(entry.path, std::move(entry));
+        }
+    }
+}
+
+bool IncrementalCache::lookup(std::size_t index, const S57Cell& cell, CellResult& result) {
+    const std::string& cellPath = cell.path;
+    Entry& current = m_current[index];
+    if (!stat_cell(cell, current.fingerprint)) {
+        return false;
+    }
+    current.path = cellPath;
+
+    auto it = m_previous.find(cellPath);
+    if (it == m_previous.end()) {
+        hash_current(cell, current);
+        return false;
+    }
+    const Entry& previous = it->second;
+
+    // 更新链长度、总大小和修改时间都没变时认为内容未变，不再读取文件计算哈希
+    if (current.fingerprint.updates != previous.fingerprint.updates) {
+        hash_current(cell, current);
+        return false; // 更新链增长或缩短，必须重新应用更新
+    }
+    if (current.fingerprint.size != previous.fingerprint.size ||
+        current.fingerprint.mtime != previous.fingerprint.mtime) {
+        if (!hash_current(cell, current) || current.fingerprint.hash != previous.fingerprint.hash) {
+            return false;
+        }
+    } else {
+        current.fingerprint.hash = previous.fingerprint.hash;
+    }
+
+    std::string shard;
+    if (!read_file(shard_path(previous.shard), shard)) {
+        return false; // 分片丢失，重新提取
+    }
+    const std::size_t eol = shard.find('\n');
+    if (eol != std::string::npos) {
+        result.header.assign(shard, 0, eol + 1);
+        result.rows.assign(shard, eol + 1, std::string::npos); // 复用流水线回收的缓冲
+    }
+    if (fs::exists(shard_path(previous.shard) + kRowInfoSuffix) &&
+        !read_row_info(shard_path(previous.shard) + kRowInfoSuffix, result.rowInfo)) {
+        result = CellResult();
+        return false; // 行信息损坏，重新提取
+    }
+    result.rowCount = previous.rows;
+    result.log = "未变化，使用缓存: " + cellPath;
+    if (!cell.updates.empty()) {
+        result.log += " (含 " + std::to_string(cell.updates.size()) + " 个更新文件)";
+    }
+    result.log += "\n";
+
+    current.shard = previous.shard;
+    current.rows = previous.rows;
+    current.valid = true;
+    current.reused = true;
+    return true;
+}
+
+void IncrementalCache::store(std::size_t index, const S57Cell& cell, const CellResult& result) {
+    const std::string& cellPath = cell.path;
+    Entry& current = m_current[index];
+    if (!result.errors.empty()) {
+        return; // 出错的图幅不缓存，下次重新处理
+    }
+    if (current.path.empty()) {
+        // lookup() 没有取得指纹 (未调用或文件无法读取)，重新读取；仍然失败时不缓存，
+        // 否则清单会记下一个与文件内容无关的哈希
+        if (!stat_cell(cell, current.fingerprint) || !hash_cell(cell, current.fingerprint.hash)) {
+            current = Entry();
+            return;
+        }
+        current.path = cellPath;
+    }
+
+    // 分片名由图幅路径和内容哈希决定，内容变化后旧分片在 save() 中被清理
+    current.shard = to_hex(fnv1a(cellPath.data(), cellPath.size())) + "-" + to_hex(current.fingerprint.hash) + ".csv";
+    boost::system::error_code ec;
+    fs::create_directories(m_cacheDir, ec);
+
+    const std::string path = shard_path(current.shard);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << result.header << result.rows;
+    if (!out || (!result.rowInfo.empty() && !write_row_info(path + kRowInfoSuffix, result.rowInfo))) {
+        std::cerr << "警告: 无法写入增量缓存分片 " << path << std::endl;
+        return;
+    }
+    if (result.rowInfo.empty()) {
+        fs::remove(path + kRowInfoSuffix, ec); // 可能是上一次切分或去重输出留下的
+    }
+    current.rows = result.rowCount;
+    current.valid = true;
+}
+
+bool IncrementalCache::save() {
+    const std::string tmpPath = m_manifestPath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        out << kManifestMagic << '\t' << m_signature << '\n';
+        for (const Entry& entry : m_current) {
+            if (!entry.valid) {
+                continue;
+            }
+            out << entry.path << '\t' << entry.fingerprint.updates << '\t' << entry.fingerprint.size << '\t'
+                << static_cast<long long>(entry.fingerprint.mtime) << '\t' << to_hex(entry.fingerprint.hash) << '\t'
+                << entry.shard << '\t' << entry.rows << '\n';
+        }
+        if (!out) {
+            std::cerr << "错误: 无法写入增量清单 " << tmpPath << std::endl;
+            return false;
+        }
+    }
+    boost::system::error_code ec;
+    fs::rename(tmpPath, m_manifestPath, ec);
+    if (ec) {
+        std::cerr << "错误: 无法更新增量清单 " << m_manifestPath << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    // 清理已删除或已变化图幅的旧分片
+    std::set<std::string> live;
+    for (const Entry& entry : m_current) {
+        if (entry.valid) {
+            live.insert(entry.shard);
+            live.insert(entry.shard + kRowInfoSuffix);
+        }
+    }
+    if (fs::is_directory(m_cacheDir, ec)) {
+        for (const auto& file : fs::directory_iterator(m_cacheDir)) {
+            if (!live.count(file.path().filename().string())) {
+                fs::remove(file.path(), ec);
+            }
+        }
+    }
+    return true;
+}
+
+std::size_t IncrementalCache::reused() const {
+    return static_cast<std::size_t>(std::count_if(m_current.begin(), m_current.end(),
+                                                  [](const Entry& e) { return e.reused; }));
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+struct CellResult;
+struct S57Cell;
+
+/**
+ * @brief 图幅的指纹：基础文件加整个更新链作为一个整体
+ *
+ * size 为所有文件大小之和，mtime 为其中最新的修改时间，hash 为按顺序
+ * 拼接所有文件内容后的哈希。
+ */
+struct CellFingerprint {
+    std::size_t updates = 0;
+    std::uintmax_t size = 0;
+    std::time_t mtime = 0;
+    std::uint64_t hash = 0;
+};
+
+/**
+ * @brief 增量导出缓存
+ *
+ * 每个图幅应用更新后的处理结果 (表头 + 数据行) 保存为缓存目录下的一个
+ * 分片文件 (切分或去重时每行的附加信息另存在同名的 .rows 文件中)，清单
+ * 文件记录图幅路径、更新文件数、指纹、分片名和行数。再次运行时更新链长度、
+ * 总大小和最新修改时间都没变的图幅直接复用分片；变化了的再比较内容哈希，
+ * 只有内容确实改变 (或新增、更新链增长) 的图幅才重新提取，更新很多的图幅
+ * 因此不必每次都重新解析和应用全部更新。清单中已不存在的图幅在保存时被
+ * 删除，因此输出会按本次扫描结果完整重建，不会残留已删除图幅的数据。
+ *
+ * 清单第一行记录导出参数签名，签名不同 (例如换了图层或字段) 时全部重新处理。
+ */
+class IncrementalCache {
+public:
+    /**
+     * @param cacheDir 分片目录
+     * @param manifestPath 清单文件路径
+     * @param signature 导出参数签名
+     */
+    IncrementalCache(std::string cacheDir, std::string manifestPath, std::string signature);
+
+    /**
+     * @brief 读取上一次的清单，并为本次的 cellCount 个图幅准备状态
+     */
+    void load(std::size_t cellCount);
+
+    /**
+     * @brief 检查图幅是否未变化；未变化时从分片读出结果 (线程安全，每个 index 只由一个线程调用)
+     */
+    bool lookup(std::size_t index, const S57Cell& cell, CellResult& result);
+
+    /**
+     * @brief 保存新提取的结果 (线程安全，每个 index 只由一个线程调用)
+     */
+    void store(std::size_t index, const S57Cell& cell, const CellResult& result);
+
+    /**
+     * @brief 写出新清单并删除不再引用的分片
+     */
+    bool save();
+
+    std::size_t reused() const;
+
+private:
+    struct Entry {
+        std::string path;
+        CellFingerprint fingerprint;
+        std::string shard;
+        std::size_t rows = 0;
+        bool valid = false;
+        bool reused = false;
+    };
+
+    // 计算 current 的内容哈希；失败时清空 current
+    bool hash_current(const S57Cell& cell, Entry& current);
+    std::string shard_path(const std::string& shard) const;
+
+    std::string m_cacheDir;
+    std::string m_manifestPath;
+    std::string m_signature;
+    std::map<std::string, Entry> m_previous; // 上一次的清单，按图幅路径索引
+    std::vector<Entry> m_current;            // 本次的清单，按图幅序号索引
+};
+
+/**
+ * @brief 读取图幅 (基础文件 + 更新链) 的更新文件数、总大小和最新修改时间，不计算哈希
+ * @return false 如果任一文件无法访问
+ */
+bool stat_cell(const S57Cell& cell, CellFingerprint& fp);
+
+/**
+ * @brief 计算文件内容的 64 位 FNV-1a 哈希
+ *
+ * @param hash 传入初始哈希值并返回结果，传入上一个文件的结果即可得到多个文件拼接后的哈希
+ * @return false 如果文件无法打开或读取，此时 hash 不可使用
+ */
+bool hash_file(const std::string& path, std::uint64_t& hash);
+
+/**
+ * @brief 计算图幅 (基础文件 + 更新链) 的组合哈希
+ * @return false 如果任一文件无法打开或读取
+ */
+bool hash_cell(const S57Cell& cell, std::uint64_t& hash);
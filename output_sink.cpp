@@ -0,0 +1,498 @@
+#include "output_sink.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+#include <boost/filesystem.hpp>
+
+#include "gdal_priv.h"
+#include "ogrsf_frmts.h"
+
+#include "cell_pipeline.h"
+#include "csv_format.h"
+
+namespace fs = boost::filesystem;
+
+// 输出缓冲区大小
+constexpr std::size_t kBufferSize = 8 << 20;
+
+namespace {
+
+// 从二进制行记录中读取一个定长值
+template <typename T>
+bool read_value(const char*& p, const char* end, T& value) {
+    if (static_cast<std::size_t>(end - p) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+// 没有任何图幅产生输出时删除上一次运行 (增量模式下输出目录被保留) 遗留的同名输出，
+// 避免旧数据与已清空的增量清单不一致
+void remove_stale_output(const std::string& path) {
+    boost::system::error_code ec;
+    fs::remove_all(path, ec);
+}
+
+} // namespace
+
+// 切分输出时单个分片的缓冲区大小，以及所有分片缓冲区的总上限
+constexpr std::size_t kTileBufferSize = 1 << 20;
+constexpr std::size_t kTileBufferTotal = 64 << 20;
+
+CsvFileSink::CsvFileSink(std::string path) : m_path(std::move(path)) {}
+
+CsvFileSink::~CsvFileSink() {
+    close();
+}
+
+bool CsvFileSink::write(const CellResult& result) {
+    if (result.header.empty() || m_failed) {
+        return !m_failed;
+    }
+    if (!m_file) {
+        const fs::path dir = fs::path(m_path).parent_path();
+        boost::system::error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec) {
+            std::cerr << "错误: 无法创建输出目录 " << dir.string() << ": " << ec.message() << std::endl;
+            m_failed = true;
+            return false;
+        }
+        m_file = std::fopen(m_path.c_str(), "wb");
+        if (!m_file) {
+            std::cerr << "错误: 无法创建输出文件 " << m_path << std::endl;
+            m_failed = true;
+            return false;
+        }
+        std::setvbuf(m_file, nullptr, _IONBF, 0); // 由 m_buffer 负责缓冲
+        m_buffer.reserve(kBufferSize);
+        m_buffer = result.header;
+    }
+    return append(result.rows);
+}
+
+bool CsvFileSink::append(const std::string& data) {
+    if (m_buffer.size() + data.size() <= kBufferSize) {
+        m_buffer += data;
+        return true;
+    }
+    if (!flush()) {
+        return false;
+    }
+    if (data.size() >= kBufferSize) {
+        // 大图幅的数据直接写出，不再经过缓冲区复制
+        if (std::fwrite(data.data(), 1, data.size(), m_file) != data.size()) {
+            std::cerr << "错误: 写入输出文件 " << m_path << " 失败" << std::endl;
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+    m_buffer += data;
+    return true;
+}
+
+bool CsvFileSink::flush() {
+    if (!m_buffer.empty()) {
+        if (std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size()) {
+            std::cerr << "错误: 写入输出文件 " << m_path << " 失败" << std::endl;
+            m_failed = true;
+            return false;
+        }
+        m_buffer.clear();
+    }
+    return true;
+}
+
+bool CsvFileSink::close() {
+    if (m_closed) {
+        return !m_failed;
+    }
+    m_closed = true;
+    if (!m_file) {
+        if (!m_failed) {
+            remove_stale_output(m_path);
+        }
+        return !m_failed;
+    }
+    bool ok = !m_failed && flush();
+    if (std::fclose(m_file) != 0) {
+        std::cerr << "错误: 关闭输出文件 " << m_path << " 失败" << std::endl;
+        ok = false;
+    }
+    m_file = nullptr;
+    m_failed = !ok;
+    return ok;
+}
+
+ZipFileSink::ZipFileSink(std::string zipPath, std::string entryName, int level, unsigned threads)
+    : m_path(std::move(zipPath)), m_entryName(std::move(entryName)), m_level(level), m_threads(threads) {}
+
+ZipFileSink::~ZipFileSink() {
+    close();
+}
+
+bool ZipFileSink::write(const CellResult& result) {
+    if (result.header.empty() || m_failed) {
+        return !m_failed;
+    }
+    if (!m_zip.is_open()) {
+        const fs::path dir = fs::path(m_path).parent_path();
+        boost::system::error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec) {
+            std::cerr << "错误: 无法创建输出目录 " << dir.string() << ": " << ec.message() << std::endl;
+            m_failed = true;
+            return false;
+        }
+        if (!m_zip.open(m_path, m_entryName, m_level, m_threads) ||
+            !m_zip.write(result.header.data(), result.header.size())) {
+            m_failed = true;
+            return false;
+        }
+    }
+    if (!m_zip.write(result.rows.data(), result.rows.size())) {
+        m_failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool ZipFileSink::close() {
+    if (m_closed) {
+        return !m_failed;
+    }
+    m_closed = true;
+    if (!m_zip.is_open()) {
+        if (!m_failed) {
+            remove_stale_output(m_path);
+        }
+        return !m_failed;
+    }
+    if (!m_zip.close()) {
+        m_failed = true;
+    }
+    return !m_failed;
+}
+
+TiledCsvSink::TiledCsvSink(std::string outputDir, std::string name, double tileSize)
+    : m_outputDir(std::move(outputDir)), m_name(std::move(name)), m_tileSize(tileSize) {
+    m_tileDir = (fs::path(m_outputDir) / (m_name + "_tiles")).string();
+}
+
+TiledCsvSink::~TiledCsvSink() {
+    close();
+}
+
+std::string TiledCsvSink::tile_file(const TileKey& key) const {
+    if (key.first == RowInfo::kEmpty) {
+        return "empty.csv";
+    }
+    return "c" + std::to_string(key.first) + "_r" + std::to_string(key.second) + ".csv";
+}
+
+bool TiledCsvSink::write(const CellResult& result) {
+    if (result.header.empty() || m_failed) {
+        return !m_failed;
+    }
+    if (m_header.empty()) {
+        m_header = result.header;
+        boost::system::error_code ec;
+        fs::create_directories(m_tileDir, ec);
+        if (ec) {
+            std::cerr << "错误: 无法创建分片目录 " << m_tileDir << ": " << ec.message() << std::endl;
+            m_failed = true;
+            return false;
+        }
+    }
+
+    std::size_t offset = 0;
+    for (const RowInfo& row : result.rowInfo) {
+        if (offset + row.size > result.rows.size()) {
+            break;
+        }
+        const TileKey key(row.column, row.row);
+        Tile& tile = m_tiles[key];
+        if (row.column != RowInfo::kEmpty) {
+            if (tile.rows == 0) {
+                tile.minX = row.minX;
+                tile.minY = row.minY;
+                tile.maxX = row.maxX;
+                tile.maxY = row.maxY;
+            } else {
+                tile.minX = std::min(tile.minX, row.minX);
+                tile.minY = std::min(tile.minY, row.minY);
+                tile.maxX = std::max(tile.maxX, row.maxX);
+                tile.maxY = std::max(tile.maxY, row.maxY);
+            }
+        }
+        tile.buffer.append(result.rows, offset, row.size);
+        tile.rows++;
+        offset += row.size;
+        m_buffered += row.size;
+
+        if (tile.buffer.size() >= kTileBufferSize && !flush(key, tile)) {
+            return false;
+        }
+    }
+    if (offset != result.rows.size()) {
+        std::cerr << "错误: 图幅数据行与网格信息不一致，无法切分输出" << std::endl;
+        m_failed = true;
+        return false;
+    }
+
+    if (m_buffered >= kTileBufferTotal) {
+        return flush_all();
+    }
+    return true;
+}
+
+bool TiledCsvSink::flush(const TileKey& key, Tile& tile) {
+    if (tile.created && tile.buffer.empty()) {
+        return true;
+    }
+    const std::string path = (fs::path(m_tileDir) / tile_file(key)).string();
+    std::FILE* file = std::fopen(path.c_str(), tile.created ? "ab" : "wb");
+    if (!file) {
+        std::cerr << "错误: 无法写入分片文件 " << path << std::endl;
+        m_failed = true;
+        return false;
+    }
+    bool ok = true;
+    if (!tile.created) {
+        ok = std::fwrite(m_header.data(), 1, m_header.size(), file) == m_header.size();
+    }
+    ok = ok && std::fwrite(tile.buffer.data(), 1, tile.buffer.size(), file) == tile.buffer.size();
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "错误: 写入分片文件 " << path << " 失败" << std::endl;
+        m_failed = true;
+        return false;
+    }
+    tile.created = true;
+    m_buffered -= tile.buffer.size();
+    tile.buffer.clear();
+    tile.buffer.shrink_to_fit(); // 分片很多时不保留每个分片的缓冲区
+    return true;
+}
+
+bool TiledCsvSink::flush_all() {
+    for (auto& entry : m_tiles) {
+        if (!flush(entry.first, entry.second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TiledCsvSink::write_index() {
+    // 清理上一次 (增量模式下输出目录被保留) 遗留的、本次已经没有数据的分片
+    std::set<std::string> live;
+    for (const auto& entry : m_tiles) {
+        live.insert(tile_file(entry.first));
+    }
+    boost::system::error_code ec;
+    if (fs::is_directory(m_tileDir, ec)) {
+        for (const auto& file : fs::directory_iterator(m_tileDir)) {
+            if (!live.count(file.path().filename().string())) {
+                fs::remove(file.path(), ec);
+            }
+        }
+    }
+
+    const std::string path = (fs::path(m_outputDir) / (m_name + "_tiles.csv")).string();
+    std::string index = "FILE,COLUMN,ROW,TILE_MINX,TILE_MINY,TILE_MAXX,TILE_MAXY,MINX,MINY,MAXX,MAXY,ROWS\n";
+    for (const auto& entry : m_tiles) {
+        const TileKey& key = entry.first;
+        const Tile& tile = entry.second;
+        append_csv_string(index, (fs::path(m_name + "_tiles") / tile_file(key)).generic_string().c_str());
+        if (key.first == RowInfo::kEmpty) {
+            index += ",,,,,,,,,,";
+        } else {
+            const double values[] = {
+                static_cast<double>(key.first), static_cast<double>(key.second),
+                key.first * m_tileSize - 180.0, key.second * m_tileSize - 90.0,
+                (key.first + 1) * m_tileSize - 180.0, (key.second + 1) * m_tileSize - 90.0,
+                tile.minX, tile.minY, tile.maxX, tile.maxY
+            };
+            for (double value : values) {
+                index += ',';
+                append_csv_real(index, value);
+            }
+        }
+        index += ',';
+        index += std::to_string(tile.rows);
+        index += '\n';
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << index;
+    if (!out) {
+        std::cerr << "错误: 无法写入分片索引 " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TiledCsvSink::close() {
+    if (m_closed) {
+        return !m_failed;
+    }
+    m_closed = true;
+    if (m_header.empty()) {
+        // 没有任何输出
+        if (!m_failed) {
+            remove_stale_output(m_tileDir);
+            remove_stale_output((fs::path(m_outputDir) / (m_name + "_tiles.csv")).string());
+        }
+        return !m_failed;
+    }
+    if (m_failed || !flush_all() || !write_index()) {
+        m_failed = true;
+    }
+    return !m_failed;
+}
+
+OgrDatasetSink::OgrDatasetSink(std::string path, OutputFormat format, std::string layerName,
+                               std::vector<OutputField> fields)
+    : m_path(std::move(path)), m_format(format), m_layerName(std::move(layerName)), m_fields(std::move(fields)) {}
+
+OgrDatasetSink::~OgrDatasetSink() {
+    close();
+}
+
+bool OgrDatasetSink::create() {
+    const char* driverName = m_format == OutputFormat::Parquet ? "Parquet" : "FlatGeobuf";
+    GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(driverName);
+    if (!driver) {
+        std::cerr << "错误: 当前 GDAL 未包含 " << driverName << " 驱动" << std::endl;
+        return false;
+    }
+
+    const fs::path dir = fs::path(m_path).parent_path();
+    boost::system::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) {
+        std::cerr << "错误: 无法创建输出目录 " << dir.string() << ": " << ec.message() << std::endl;
+        return false;
+    }
+    m_dataset = driver->Create(m_path.c_str(), 0, 0, 0, GDT_Unknown, nullptr);
+    if (!m_dataset) {
+        std::cerr << "错误: 无法创建输出文件 " << m_path << ": " << CPLGetLastErrorMsg() << std::endl;
+        return false;
+    }
+
+    // S57 坐标为 WGS84 经纬度，按 x=经度、y=纬度 的顺序写出
+    OGRSpatialReference srs;
+    srs.importFromEPSG(4326);
+    srs.SetAxisMappingStrategy(OAMS_TRADITIONAL_GIS_ORDER);
+
+    const char* papszLayerOptions[] = {
+        m_format == OutputFormat::Parquet ? "GEOMETRY_ENCODING=WKB" : "SPATIAL_INDEX=YES",
+        nullptr
+    };
+    m_layer = m_dataset->CreateLayer(m_layerName.c_str(), &srs, wkbUnknown, const_cast<char**>(papszLayerOptions));
+    if (!m_layer) {
+        std::cerr << "错误: 无法在 " << m_path << " 中创建图层: " << CPLGetLastErrorMsg() << std::endl;
+        return false;
+    }
+    for (const OutputField& field : m_fields) {
+        OGRFieldDefn defn(field.name.c_str(), field.kind == OutputField::Real ? OFTReal : OFTString);
+        if (m_layer->CreateField(&defn) != OGRERR_NONE) {
+            std::cerr << "错误: 无法创建字段 " << field.name << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OgrDatasetSink::write(const CellResult& result) {
+    if (result.header.empty() || m_failed) {
+        return !m_failed;
+    }
+    if (!m_layer && !create()) {
+        m_failed = true;
+        return false;
+    }
+
+    OGRFeatureDefn* defn = m_layer->GetLayerDefn();
+    const char* p = result.rows.data();
+    const char* end = p + result.rows.size();
+    std::string value;
+    OGRFeature feature(defn); // 所有行复用同一个要素：每行的几何和全部字段都会被重新设置
+    while (p < end) {
+        feature.SetFID(OGRNullFID); // CreateFeature 会写回新要素的 FID
+
+        std::uint32_t wkbSize = 0;
+        if (!read_value(p, end, wkbSize) || static_cast<std::size_t>(end - p) < wkbSize) {
+            break;
+        }
+        OGRGeometry* geom = nullptr;
+        if (wkbSize > 0) {
+            if (OGRGeometryFactory::createFromWkb(p, nullptr, &geom, wkbSize, wkbVariantIso) != OGRERR_NONE) {
+                geom = nullptr;
+            }
+            p += wkbSize;
+        }
+        feature.SetGeometryDirectly(geom);
+
+        bool ok = true;
+        for (std::size_t i = 0; ok && i < m_fields.size(); ++i) {
+            if (m_fields[i].kind == OutputField::Real) {
+                double number = 0;
+                ok = read_value(p, end, number);
+                feature.SetField(static_cast<int>(i), number);
+            } else {
+                std::uint32_t size = 0;
+                ok = read_value(p, end, size) && static_cast<std::size_t>(end - p) >= size;
+                if (ok) {
+                    value.assign(p, size);
+                    p += size;
+                    feature.SetField(static_cast<int>(i), value.c_str());
+                }
+            }
+        }
+        if (!ok) {
+            break;
+        }
+
+        if (m_layer->CreateFeature(&feature) != OGRERR_NONE) {
+            std::cerr << "错误: 写入 " << m_path << " 失败: " << CPLGetLastErrorMsg() << std::endl;
+            m_failed = true;
+            return false;
+        }
+    }
+    if (p != end) {
+        std::cerr << "错误: 图幅的二进制行记录不完整，无法写入 " << m_path << std::endl;
+        m_failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool OgrDatasetSink::close() {
+    if (m_closed) {
+        return !m_failed;
+    }
+    m_closed = true;
+    if (!m_dataset && !m_failed) {
+        remove_stale_output(m_path);
+    }
+    if (m_dataset) {
+        CPLErrorReset();
+        GDALClose(GDALDataset::ToHandle(m_dataset));
+        if (CPLGetLastErrorType() == CE_Failure) {
+            std::cerr << "错误: 关闭输出文件 " << m_path << " 失败: " << CPLGetLastErrorMsg() << std::endl;
+            m_failed = true;
+        }
+        m_dataset = nullptr;
+        m_layer = nullptr;
+    }
+    return !m_failed;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "row_encoder.h"
+#include "zip_stream.h"
+
+class GDALDataset;
+class OGRLayer;
+struct CellResult;
+
+/**
+ * @brief 输出端接口
+ *
+ * 在 main() 中创建一次，由写出线程按图幅顺序接收所有图幅的结果，
+ * 处理结束后调用 close() 统一刷新并关闭，不再逐个图幅打开/关闭输出数据集。
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    /**
+     * @brief 写入一个图幅的结果 (表头为空的结果会被忽略)
+     * @return false 如果写入失败，写出线程将停止写出
+     */
+    virtual bool write(const CellResult& result) = 0;
+
+    /**
+     * @brief 刷新并关闭输出；没有收到任何非空图幅时删除目标位置上已有的旧输出
+     * @return false 如果刷新或关闭失败
+     */
+    virtual bool close() = 0;
+};
+
+/**
+ * @brief 单个 CSV 文件输出端，在收到第一个非空图幅时创建文件并写入表头
+ *
+ * 数据先汇集到一块可复用的大缓冲区，缓冲区满时才调用一次 fwrite
+ * (文件本身不再做 stdio 缓冲)，避免大量小块写入。
+ */
+class CsvFileSink : public OutputSink {
+public:
+    explicit CsvFileSink(std::string path);
+    ~CsvFileSink() override;
+
+    bool write(const CellResult& result) override;
+    bool close() override;
+
+private:
+    bool append(const std::string& data);
+    bool flush();
+
+    std::string m_path;
+    std::FILE* m_file = nullptr;
+    std::string m_buffer;
+    bool m_closed = false;
+    bool m_failed = false;
+};
+
+/**
+ * @brief ZIP 输出端：CSV 数据边产生边压缩进只含一个条目的 ZIP 存档，
+ *        未压缩的 CSV 不会写到磁盘上
+ */
+class ZipFileSink : public OutputSink {
+public:
+    /**
+     * @param zipPath 目标 ZIP 文件路径
+     * @param entryName 存档内的 CSV 文件名
+     * @param level 压缩级别
+     * @param threads 压缩线程数，> 1 时分块并行压缩
+     */
+    ZipFileSink(std::string zipPath, std::string entryName, int level, unsigned threads = 1);
+    ~ZipFileSink() override;
+
+    bool write(const CellResult& result) override;
+    bool close() override;
+
+private:
+    std::string m_path;
+    std::string m_entryName;
+    int m_level;
+    unsigned m_threads;
+    ZipStreamWriter m_zip;
+    bool m_closed = false;
+    bool m_failed = false;
+};
+
+/**
+ * @brief 按经纬度网格切分的 CSV 输出端
+ *
+ * 每行按 CellResult::rowInfo 中的网格写到 <outputDir>/<name>_tiles/ 下各自的
+ * 分片文件 (c<列>_r<行>.csv，空几何写到 empty.csv)，每个分片都带表头。
+ * 关闭时写出分片索引 <outputDir>/<name>_tiles.csv，记录每个分片的网格范围、
+ * 数据的实际外包矩形和行数，下游可以按区域并行加载、跳过无关分片。
+ *
+ * 分片数据先在各自的缓冲区中汇集，缓冲区满或总缓冲量超限时才追加到文件，
+ * 因此任意时刻最多只打开一个文件。
+ */
+class TiledCsvSink : public OutputSink {
+public:
+    /**
+     * @param outputDir 输出目录
+     * @param name 输出名 (不含后缀)
+     * @param tileSize 网格边长 (度)
+     */
+    TiledCsvSink(std::string outputDir, std::string name, double tileSize);
+    ~TiledCsvSink() override;
+
+    bool write(const CellResult& result) override;
+    bool close() override;
+
+private:
+    struct Tile {
+        std::string buffer;
+        std::size_t rows = 0;
+        bool created = false; // 文件已创建 (之后的写入改为追加)
+        double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    };
+    using TileKey = std::pair<std::int32_t, std::int32_t>; // (列, 行)
+
+    std::string tile_file(const TileKey& key) const;
+    bool flush(const TileKey& key, Tile& tile);
+    bool flush_all();
+    bool write_index();
+
+    std::string m_outputDir;
+    std::string m_name;
+    std::string m_tileDir;
+    double m_tileSize;
+    std::string m_header;
+    std::map<TileKey, Tile> m_tiles;
+    std::size_t m_buffered = 0;
+    bool m_closed = false;
+    bool m_failed = false;
+};
+
+/**
+ * @brief GDAL 矢量数据集输出端，用于 FlatGeobuf、GeoParquet 等二进制格式
+ *
+ * 接收 RowEncoder 生成的二进制行记录，解码后通过 OGRLayer::CreateFeature
+ * 写入单个图层。几何直接由 WKB 构造，深度等数值字段保存为原生的 Real 列。
+ * 数据集在收到第一个非空图幅时创建，close() 时关闭并完成写出
+ * (FlatGeobuf 在此时生成空间索引)。
+ */
+class OgrDatasetSink : public OutputSink {
+public:
+    /**
+     * @param path 输出文件路径
+     * @param format 输出格式 (不能是 OutputFormat::Csv)
+     * @param layerName 图层名
+     * @param fields 输出列，与 RowEncoder 写入字段的顺序一致
+     */
+    OgrDatasetSink(std::string path, OutputFormat format, std::string layerName, std::vector<OutputField> fields);
+    ~OgrDatasetSink() override;
+
+    bool write(const CellResult& result) override;
+    bool close() override;
+
+private:
+    bool create();
+
+    std::string m_path;
+    OutputFormat m_format;
+    std::string m_layerName;
+    std::vector<OutputField> m_fields;
+    GDALDataset* m_dataset = nullptr;
+    OGRLayer* m_layer = nullptr;
+    bool m_closed = false;
+    bool m_failed = false;
+};
@@ -0,0 +1,35 @@
+#include "row_dedup.h"
+
+#include <string>
+#include <vector>
+
+#include "cell_pipeline.h"
+
+void RowDeduplicator::filter(CellResult& result) {
+    std::size_t offset = 0;
+    std::size_t kept = 0; // 已保留的行数；在遇到第一个重复行之前原地保留，不复制
+    std::string rows;
+    bool copying = false;
+    for (std::size_t i = 0; i < result.rowInfo.size(); ++i) {
+        const RowInfo& info = result.rowInfo[i];
+        const bool duplicate = !m_seen.insert(info.key).second;
+        if (duplicate) {
+            ++m_dropped;
+            if (!copying) {
+                rows.assign(result.rows, 0, offset);
+                copying = true;
+            }
+        } else {
+            if (copying) {
+                rows.append(result.rows, offset, info.size);
+            }
+            result.rowInfo[kept++] = info;
+        }
+        offset += info.size;
+    }
+    if (copying) {
+        result.rows = std::move(rows);
+        result.rowInfo.resize(kept);
+        result.rowCount = kept;
+    }
+}
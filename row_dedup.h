@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+
+struct CellResult;
+
+/**
+ * @brief 跨图幅去重，在写出线程中对每个图幅的结果调用
+ *
+ * 按 RowInfo::key (图层、属性和输出几何的哈希，不含图幅等级) 丢弃之前的
+ * 图幅中已经写出过的行。图幅按等级从高到低处理时，保留下来的就是最大
+ * 比例尺图幅中的那一份。只在写出线程中使用，不需要加锁。
+ */
+class RowDeduplicator {
+public:
+    /**
+     * @brief 从 result 中删除重复的行 (rows 与 rowInfo 同步删除)
+     */
+    void filter(CellResult& result);
+
+    std::size_t dropped() const { return m_dropped; }
+
+private:
+    std::unordered_set<std::uint64_t> m_seen;
+    std::size_t m_dropped = 0;
+};
@@ -0,0 +1,140 @@
+#include "row_encoder.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "ogr_geometry.h"
+
+#include "csv_format.h"
+
+namespace {
+
+constexpr std::uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+void append_u32(std::string& out, std::uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // namespace
+
+bool parse_output_format(const std::string& name, OutputFormat& format) {
+    if (name == "csv") {
+        format = OutputFormat::Csv;
+    } else if (name == "fgb" || name == "flatgeobuf") {
+        format = OutputFormat::FlatGeobuf;
+    } else if (name == "parquet" || name == "geoparquet") {
+        format = OutputFormat::Parquet;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* output_format_extension(OutputFormat format) {
+    switch (format) {
+    case OutputFormat::FlatGeobuf:
+        return "fgb";
+    case OutputFormat::Parquet:
+        return "parquet";
+    default:
+        return "csv";
+    }
+}
+
+void RowEncoder::hash_pending(const std::string& out) {
+    for (std::size_t i = m_hashed; i < out.size(); ++i) {
+        m_hash ^= static_cast<unsigned char>(out[i]);
+        m_hash *= kFnvPrime;
+    }
+    m_hashed = out.size();
+}
+
+void RowEncoder::begin(std::string& out, const OGRGeometry* poGeom) {
+    m_hashed = out.size();
+    m_hash = kFnvOffset;
+    if (m_format == OutputFormat::Csv) {
+        append_csv_wkt(out, poGeom);
+        return;
+    }
+    if (!poGeom) {
+        append_u32(out, 0);
+        return;
+    }
+    const std::size_t size = poGeom->WkbSize();
+    append_u32(out, static_cast<std::uint32_t>(size));
+    const std::size_t offset = out.size();
+    out.resize(offset + size);
+    poGeom->exportToWkb(wkbNDR, reinterpret_cast<unsigned char*>(&out[offset]), wkbVariantIso);
+}
+
+void RowEncoder::begin_point(std::string& out, double x, double y) {
+    m_hashed = out.size();
+    m_hash = kFnvOffset;
+    if (m_format == OutputFormat::Csv) {
+        append_csv_point(out, x, y);
+        return;
+    }
+    // ISO WKB 点：字节序 (1 = 小端)、类型 (1 = Point)、x、y
+    constexpr std::uint32_t kPointWkbSize = 1 + 4 + 2 * 8;
+    append_u32(out, kPointWkbSize);
+    const std::size_t offset = out.size();
+    out.resize(offset + kPointWkbSize);
+    unsigned char* p = reinterpret_cast<unsigned char*>(&out[offset]);
+    p[0] = 1;
+    const std::uint32_t type = 1;
+    const double xy[2] = {x, y};
+    for (int i = 0; i < 4; ++i) {
+        p[1 + i] = static_cast<unsigned char>(type >> (8 * i));
+    }
+    for (int c = 0; c < 2; ++c) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &xy[c], sizeof(bits));
+        for (int i = 0; i < 8; ++i) {
+            p[5 + 8 * c + i] = static_cast<unsigned char>(bits >> (8 * i));
+        }
+    }
+}
+
+void RowEncoder::add_string(std::string& out, const char* value, bool key) {
+    if (m_keys && !key) {
+        hash_pending(out);
+    }
+    if (m_format == OutputFormat::Csv) {
+        out += ',';
+        append_csv_string(out, value);
+    } else {
+        const std::size_t size = std::strlen(value);
+        append_u32(out, static_cast<std::uint32_t>(size));
+        out.append(value, size);
+    }
+    if (!key) {
+        m_hashed = out.size(); // 跳过该字段
+    }
+}
+
+void RowEncoder::add_real(std::string& out, double value, bool key) {
+    if (m_keys && !key) {
+        hash_pending(out);
+    }
+    if (m_format == OutputFormat::Csv) {
+        out += ',';
+        append_csv_real(out, value);
+    } else {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    if (!key) {
+        m_hashed = out.size();
+    }
+}
+
+std::uint64_t RowEncoder::end(std::string& out) {
+    if (m_format == OutputFormat::Csv) {
+        out += '\n';
+    }
+    if (!m_keys) {
+        return 0;
+    }
+    hash_pending(out);
+    return m_hash;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class OGRGeometry;
+
+/**
+ * @brief 输出格式
+ */
+enum class OutputFormat {
+    Csv,        // WKT + CSV 文本 (默认)
+    FlatGeobuf, // FlatGeobuf，带打包的 R 树空间索引
+    Parquet     // GeoParquet，几何为 WKB 列，字符串列使用字典编码
+};
+
+/**
+ * @brief 解析 --format 参数 (csv、fgb、parquet)
+ * @return false 如果格式名无法识别
+ */
+bool parse_output_format(const std::string& name, OutputFormat& format);
+
+/**
+ * @brief 输出格式对应的文件后缀 (不含点)
+ */
+const char* output_format_extension(OutputFormat format);
+
+/**
+ * @brief 输出列
+ */
+struct OutputField {
+    enum Kind { String, Real };
+
+    std::string name;
+    Kind kind;
+};
+
+/**
+ * @brief 把一行数据 (几何 + 字段) 追加到 CellResult::rows
+ *
+ * CSV 格式下直接生成 CSV 文本行；二进制格式下生成紧凑的行记录，由
+ * OgrDatasetSink 解码后写入 GDAL 数据集，工作线程因此不必生成 WKT 文本：
+ *
+ *   uint32 WKB 字节数 (0 表示几何为空) + WKB (ISO, 小端)
+ *   每个字段依次为：Real 为 8 字节 double；String 为 uint32 字节数 + 字节
+ *
+ * 所有整数均为本机字节序，记录只在同一进程 (及其增量缓存) 内使用。
+ * 调用顺序为 begin()、与输出列一一对应的 add_string()/add_real()、end()。
+ *
+ * 需要去重时，编码器同时对每行编码后的字节 (几何 + 字段) 计算 64 位哈希作为
+ * 去重键；key 为 false 的字段 (例如图幅等级) 不参与计算，因此不同图幅中
+ * 几何和属性都相同的要素得到同一个键。
+ */
+class RowEncoder {
+public:
+    /**
+     * @param keys 是否计算去重键
+     */
+    explicit RowEncoder(OutputFormat format, bool keys = false) : m_format(format), m_keys(keys) {}
+
+    void begin(std::string& out, const OGRGeometry* poGeom);
+
+    /**
+     * @brief 以二维点开始一行，输出与 begin() 传入同一个 OGRPoint 相同，用于不构造几何对象的批量路径
+     */
+    void begin_point(std::string& out, double x, double y);
+    void add_string(std::string& out, const char* value, bool key = true);
+    void add_real(std::string& out, double value, bool key = true);
+
+    /**
+     * @return 本行的去重键 (不计算时为 0)
+     */
+    std::uint64_t end(std::string& out);
+
+private:
+    void hash_pending(const std::string& out);
+
+    OutputFormat m_format;
+    bool m_keys;
+    std::size_t m_hashed = 0; // out 中已计入哈希 (或被跳过) 的位置
+    std::uint64_t m_hash = 0;
+};
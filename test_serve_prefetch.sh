@@ -0,0 +1,48 @@
+#!/bin/bash
+
+# 服务模式下两个使用 --prefetch 的作业同时运行时，输出应与单独运行完全相同
+# (两个作业的预读器各用自己的 /vsimem/ 目录，不会互相覆盖或释放对方的图幅)
+
+# --- 配置区 ---
+# 输入S57文件的目录 (两个作业读取同一批图幅，预读的路径最容易冲突)
+S57_DIR="${1:-/mnt/d/Maps/S-57_C1_base_24_WK43}"
+# export_depth 程序
+EXPORT_DEPTH="${EXPORT_DEPTH:-./build/export_depth}"
+# 临时输出目录
+WORK_DIR="$(mktemp -d)"
+# ----------------
+
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+# 单独运行一次作为参照
+if ! "$EXPORT_DEPTH" -i "$S57_DIR" -o "$WORK_DIR/reference" -j 2 > "$WORK_DIR/reference.log" 2>&1; then
+    echo "失败: 参照导出出错，见 $WORK_DIR/reference.log"
+    cat "$WORK_DIR/reference.log"
+    exit 1
+fi
+
+# 两个作业同时执行，各自预读
+printf '%s\n' \
+    "-i \"$S57_DIR\" -o \"$WORK_DIR/a\" -j 2 --prefetch 4" \
+    "-i \"$S57_DIR\" -o \"$WORK_DIR/b\" -j 2 --prefetch 4" \
+    "quit" | "$EXPORT_DEPTH" --serve --serve-jobs 2 > "$WORK_DIR/serve.log" 2>&1
+
+status=0
+for job in 1 2; do
+    if ! grep -q "作业 $job 结束: 退出码 0" "$WORK_DIR/serve.log"; then
+        echo "失败: 作业 $job 没有成功结束"
+        status=1
+    fi
+done
+for out in a b; do
+    if ! cmp -s "$WORK_DIR/reference/depth.csv" "$WORK_DIR/$out/depth.csv"; then
+        echo "失败: 作业输出 $out/depth.csv 与单独运行的结果不同"
+        status=1
+    fi
+done
+
+if [ $status -ne 0 ]; then
+    cat "$WORK_DIR/serve.log"
+    exit 1
+fi
+echo "通过: 两个同时预读的作业输出与单独运行一致"
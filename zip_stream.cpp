@@ -0,0 +1,434 @@
+#include "zip_stream.h"
+
+#include <ctime>
+#include <iostream>
+
+#include "miniz.h"
+
+namespace {
+
+// 压缩输出缓冲区满 1MB 时写出一次
+constexpr std::size_t kOutputChunk = 1 << 20;
+
+// 并行压缩时每个块的输入大小
+constexpr std::size_t kBlockSize = 1 << 20;
+
+// ZIP 格式常量
+constexpr std::uint32_t kLocalHeaderSig = 0x04034b50;
+constexpr std::uint32_t kCentralHeaderSig = 0x02014b50;
+constexpr std::uint32_t kEndOfCentralDirSig = 0x06054b50;
+constexpr std::uint32_t kZip64EndOfCentralDirSig = 0x06064b50;
+constexpr std::uint32_t kZip64LocatorSig = 0x07064b50;
+constexpr std::uint16_t kZip64ExtraId = 0x0001;
+constexpr std::uint16_t kVersionZip64 = 45;
+constexpr std::uint16_t kFlagUtf8 = 0x0800;
+constexpr std::uint16_t kMethodDeflate = 8;
+constexpr std::uint32_t kMax32 = 0xFFFFFFFFu;
+
+// CRC32 在本地文件头中的偏移
+constexpr long kLocalCrcOffset = 14;
+
+void put16(std::string& out, std::uint16_t v) {
+    out += static_cast<char>(v & 0xFF);
+    out += static_cast<char>(v >> 8);
+}
+
+void put32(std::string& out, std::uint32_t v) {
+    put16(out, static_cast<std::uint16_t>(v & 0xFFFF));
+    put16(out, static_cast<std::uint16_t>(v >> 16));
+}
+
+void put64(std::string& out, std::uint64_t v) {
+    put32(out, static_cast<std::uint32_t>(v & kMax32));
+    put32(out, static_cast<std::uint32_t>(v >> 32));
+}
+
+// 以下两个函数和 crc32_combine 来自 zlib 的 GF(2) 矩阵算法：
+// 已知 crc(A)、crc(B) 和 B 的长度，求 crc(A+B)
+std::uint32_t gf2_matrix_times(const std::uint32_t* mat, std::uint32_t vec) {
+    std::uint32_t sum = 0;
+    while (vec) {
+        if (vec & 1) sum ^= *mat;
+        vec >>= 1;
+        ++mat;
+    }
+    return sum;
+}
+
+void gf2_matrix_square(std::uint32_t* square, const std::uint32_t* mat) {
+    for (int n = 0; n < 32; ++n) {
+        square[n] = gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+std::uint32_t crc32_combine(std::uint32_t crc1, std::uint32_t crc2, std::uint64_t len2) {
+    if (len2 == 0) {
+        return crc1;
+    }
+    std::uint32_t even[32];
+    std::uint32_t odd[32];
+
+    odd[0] = 0xedb88320u; // CRC-32 多项式
+    std::uint32_t row = 1;
+    for (int n = 1; n < 32; ++n) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    gf2_matrix_square(even, odd); // 2 个 0 比特的算子
+    gf2_matrix_square(odd, even); // 4 个 0 比特的算子
+
+    do {
+        gf2_matrix_square(even, odd);
+        if (len2 & 1) crc1 = gf2_matrix_times(even, crc1);
+        len2 >>= 1;
+        if (len2 == 0) break;
+        gf2_matrix_square(odd, even);
+        if (len2 & 1) crc1 = gf2_matrix_times(odd, crc1);
+        len2 >>= 1;
+    } while (len2 != 0);
+
+    return crc1 ^ crc2;
+}
+
+mz_bool append_to_string(const void* buf, int len, void* user) {
+    static_cast<std::string*>(user)->append(static_cast<const char*>(buf), static_cast<std::size_t>(len));
+    return MZ_TRUE;
+}
+
+} // namespace
+
+struct ZipStreamWriter::Deflater {
+    tdefl_compressor compressor;
+};
+
+ZipStreamWriter::ZipStreamWriter() = default;
+
+ZipStreamWriter::~ZipStreamWriter() {
+    if (m_file) {
+        close();
+    }
+}
+
+bool ZipStreamWriter::open(const std::string& zipPath, const std::string& entryName, int level, unsigned threads) {
+    m_path = zipPath;
+    m_entryName = entryName;
+    m_file = std::fopen(zipPath.c_str(), "wb");
+    if (!m_file) {
+        std::cerr << "错误: 无法创建 ZIP 文件 " << zipPath << std::endl;
+        return false;
+    }
+
+    const std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    // 服务模式下多个作业可能同时打开 ZIP 输出，std::localtime 的静态缓冲不可重入
+#if defined(_WIN32)
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm);
+#endif
+    m_dosTime = static_cast<std::uint16_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec >> 1));
+    m_dosDate = static_cast<std::uint16_t>(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+
+    // 本地文件头：大小未知，先写占位值，close() 时回填
+    std::string header;
+    put32(header, kLocalHeaderSig);
+    put16(header, kVersionZip64);
+    put16(header, kFlagUtf8);
+    put16(header, kMethodDeflate);
+    put16(header, m_dosTime);
+    put16(header, m_dosDate);
+    put32(header, 0);      // CRC32
+    put32(header, kMax32); // 压缩后大小 (见 ZIP64 扩展字段)
+    put32(header, kMax32); // 原始大小 (见 ZIP64 扩展字段)
+    put16(header, static_cast<std::uint16_t>(entryName.size()));
+    put16(header, 20);     // 扩展字段长度
+    header += entryName;
+    put16(header, kZip64ExtraId);
+    put16(header, 16);
+    put64(header, 0);      // 原始大小
+    put64(header, 0);      // 压缩后大小
+    if (!write_raw(header.data(), header.size())) {
+        return false;
+    }
+
+    // 原始 deflate 流 (负的窗口位数表示不写 zlib 头)
+    m_flags = static_cast<int>(tdefl_create_comp_flags_from_zip_params(level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+    m_crc = static_cast<std::uint32_t>(mz_crc32(MZ_CRC32_INIT, nullptr, 0));
+
+    if (threads > 1) {
+        m_stopping = false;
+        m_current = std::make_shared<Block>();
+        m_current->input.reserve(kBlockSize + kOutputChunk);
+        for (unsigned t = 0; t < threads; ++t) {
+            m_workers.emplace_back(&ZipStreamWriter::compress_worker, this);
+        }
+        return true;
+    }
+
+    m_deflater.reset(new Deflater);
+    if (tdefl_init(&m_deflater->compressor, &ZipStreamWriter::put_buf, this, m_flags) != TDEFL_STATUS_OKAY) {
+        std::cerr << "错误: 初始化 deflate 压缩器失败" << std::endl;
+        m_failed = true;
+        return false;
+    }
+    m_output.reserve(kOutputChunk * 2);
+    return true;
+}
+
+void ZipStreamWriter::compress_worker() {
+    // 每个线程复用自己的压缩器，每个块重新初始化一次
+    std::unique_ptr<Deflater> deflater(new Deflater);
+    for (;;) {
+        std::shared_ptr<Block> block;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workReady.wait(lock, [&] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            block = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        const auto* data = reinterpret_cast<const unsigned char*>(block->input.data());
+        block->size = block->input.size();
+        block->crc = static_cast<std::uint32_t>(mz_crc32(MZ_CRC32_INIT, data, block->input.size()));
+        block->output.reserve(block->input.size() / 2);
+
+        // 非最后一块以 sync flush 结尾，保证按字节对齐、可直接拼接
+        const tdefl_flush flush = block->last ? TDEFL_FINISH : TDEFL_SYNC_FLUSH;
+        const tdefl_status expected = block->last ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY;
+        const bool ok = tdefl_init(&deflater->compressor, append_to_string, &block->output, m_flags) == TDEFL_STATUS_OKAY &&
+                  tdefl_compress_buffer(&deflater->compressor, data, block->input.size(), flush) == expected;
+        block->input.clear();
+        block->input.shrink_to_fit();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            block->ok = ok;
+            block->done = true;
+        }
+        m_blockDone.notify_all();
+    }
+}
+
+void ZipStreamWriter::submit_block(bool last) {
+    m_current->last = last;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back(m_current);
+        m_queue.push_back(std::move(m_current));
+    }
+    m_workReady.notify_one();
+    if (!last) {
+        m_current = std::make_shared<Block>();
+        m_current->input.reserve(kBlockSize + kOutputChunk);
+    }
+}
+
+bool ZipStreamWriter::drain_blocks(std::size_t maxPending) {
+    // 按顺序写出已完成的块；等待中的块超过 maxPending 时阻塞 (反压)
+    for (;;) {
+        std::shared_ptr<Block> block;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_pending.empty()) {
+                return true;
+            }
+            if (!m_pending.front()->done) {
+                if (m_pending.size() <= maxPending) {
+                    return true;
+                }
+                m_blockDone.wait(lock, [&] { return m_pending.front()->done; });
+            }
+            block = std::move(m_pending.front());
+            m_pending.pop_front();
+        }
+
+        if (!block->ok) {
+            std::cerr << "错误: deflate 分块压缩失败" << std::endl;
+            m_failed = true;
+            return false;
+        }
+
+        m_crc = crc32_combine(m_crc, block->crc, block->size);
+        if (!write_raw(block->output.data(), block->output.size())) {
+            return false;
+        }
+        m_compressed += block->output.size();
+    }
+}
+
+bool ZipStreamWriter::write(const char* data, std::size_t size) {
+    if (!m_file || m_failed) {
+        return false;
+    }
+    if (size == 0) {
+        return true;
+    }
+    m_uncompressed += size;
+
+    if (!m_workers.empty()) {
+        m_current->input.append(data, size);
+        if (m_current->input.size() < kBlockSize) {
+            return true;
+        }
+        submit_block(false);
+        return drain_blocks(m_workers.size() * 2);
+    }
+
+    m_crc = static_cast<std::uint32_t>(mz_crc32(m_crc, reinterpret_cast<const unsigned char*>(data), size));
+    if (tdefl_compress_buffer(&m_deflater->compressor, data, size, TDEFL_NO_FLUSH) != TDEFL_STATUS_OKAY) {
+        m_failed = true;
+    }
+    return !m_failed && (m_output.size() < kOutputChunk || flush_output());
+}
+
+int ZipStreamWriter::put_buf(const void* buf, int len, void* user) {
+    auto* self = static_cast<ZipStreamWriter*>(user);
+    self->m_output.append(static_cast<const char*>(buf), static_cast<std::size_t>(len));
+    self->m_compressed += static_cast<std::uint64_t>(len);
+    return MZ_TRUE;
+}
+
+bool ZipStreamWriter::flush_output() {
+    const bool ok = write_raw(m_output.data(), m_output.size());
+    m_output.clear();
+    return ok;
+}
+
+bool ZipStreamWriter::write_raw(const void* data, std::size_t size) {
+    if (std::fwrite(data, 1, size, m_file) != size) {
+        std::cerr << "错误: 写入 ZIP 文件 " << m_path << " 失败" << std::endl;
+        m_failed = true;
+        return false;
+    }
+    m_offset += size;
+    return true;
+}
+
+bool ZipStreamWriter::close() {
+    if (!m_file) {
+        return !m_failed;
+    }
+
+    if (!m_workers.empty()) {
+        // 最后一块 (可能为空) 以 TDEFL_FINISH 结束整个 deflate 流
+        if (!m_failed) {
+            submit_block(true);
+            drain_blocks(0);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_workReady.notify_all();
+        for (auto& t : m_workers) {
+            t.join();
+        }
+        m_workers.clear();
+        m_queue.clear();
+        m_pending.clear();
+        m_current.reset();
+    } else {
+        if (!m_failed && m_deflater &&
+            tdefl_compress_buffer(&m_deflater->compressor, nullptr, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE) {
+            std::cerr << "错误: 结束 deflate 压缩流失败" << std::endl;
+            m_failed = true;
+        }
+        m_deflater.reset();
+        if (!m_failed) {
+            flush_output();
+        }
+    }
+
+    if (!m_failed) {
+        // 中央目录：只有超过 32 位范围的值才放进 ZIP64 扩展字段
+        const bool bigUncompressed = m_uncompressed >= kMax32;
+        const bool bigCompressed = m_compressed >= kMax32;
+        std::string extra;
+        if (bigUncompressed) put64(extra, m_uncompressed);
+        if (bigCompressed) put64(extra, m_compressed);
+
+        std::string central;
+        put32(central, kCentralHeaderSig);
+        put16(central, kVersionZip64); // 创建版本
+        put16(central, kVersionZip64); // 解压所需版本
+        put16(central, kFlagUtf8);
+        put16(central, kMethodDeflate);
+        put16(central, m_dosTime);
+        put16(central, m_dosDate);
+        put32(central, m_crc);
+        put32(central, bigCompressed ? kMax32 : static_cast<std::uint32_t>(m_compressed));
+        put32(central, bigUncompressed ? kMax32 : static_cast<std::uint32_t>(m_uncompressed));
+        put16(central, static_cast<std::uint16_t>(m_entryName.size()));
+        put16(central, static_cast<std::uint16_t>(extra.empty() ? 0 : extra.size() + 4));
+        put16(central, 0); // 注释长度
+        put16(central, 0); // 起始磁盘号
+        put16(central, 0); // 内部属性
+        put32(central, 0); // 外部属性
+        put32(central, 0); // 本地文件头偏移
+        central += m_entryName;
+        if (!extra.empty()) {
+            put16(central, kZip64ExtraId);
+            put16(central, static_cast<std::uint16_t>(extra.size()));
+            central += extra;
+        }
+
+        const std::uint64_t centralOffset = m_offset;
+        const std::uint64_t centralSize = central.size();
+        const bool zip64 = centralOffset >= kMax32;
+
+        std::string tail;
+        if (zip64) {
+            const std::uint64_t zip64EndOffset = centralOffset + centralSize;
+            put32(tail, kZip64EndOfCentralDirSig);
+            put64(tail, 44);   // 记录剩余部分的长度
+            put16(tail, kVersionZip64);
+            put16(tail, kVersionZip64);
+            put32(tail, 0);
+            put32(tail, 0);
+            put64(tail, 1);
+            put64(tail, 1);
+            put64(tail, centralSize);
+            put64(tail, centralOffset);
+
+            put32(tail, kZip64LocatorSig);
+            put32(tail, 0);
+            put64(tail, zip64EndOffset);
+            put32(tail, 1);
+        }
+        put32(tail, kEndOfCentralDirSig);
+        put16(tail, 0);
+        put16(tail, 0);
+        put16(tail, 1);
+        put16(tail, 1);
+        put32(tail, static_cast<std::uint32_t>(centralSize));
+        put32(tail, zip64 ? kMax32 : static_cast<std::uint32_t>(centralOffset));
+        put16(tail, 0);
+
+        if (write_raw(central.data(), central.size()) && write_raw(tail.data(), tail.size())) {
+            // 回填本地文件头中的 CRC32 和 ZIP64 扩展字段里的大小
+            std::string crc;
+            put32(crc, m_crc);
+            std::string sizes;
+            put64(sizes, m_uncompressed);
+            put64(sizes, m_compressed);
+            const long sizesOffset = static_cast<long>(30 + m_entryName.size() + 4);
+            if (std::fseek(m_file, kLocalCrcOffset, SEEK_SET) != 0 ||
+                std::fwrite(crc.data(), 1, crc.size(), m_file) != crc.size() ||
+                std::fseek(m_file, sizesOffset, SEEK_SET) != 0 ||
+                std::fwrite(sizes.data(), 1, sizes.size(), m_file) != sizes.size()) {
+                std::cerr << "错误: 回填 ZIP 文件头失败 " << m_path << std::endl;
+                m_failed = true;
+            }
+        }
+    }
+
+    if (std::fclose(m_file) != 0) {
+        std::cerr << "错误: 关闭 ZIP 文件 " << m_path << " 失败" << std::endl;
+        m_failed = true;
+    }
+    m_file = nullptr;
+    return !m_failed;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 流式写出只含一个条目的 ZIP 存档
+ *
+ * 数据边产生边经 miniz 的 tdefl 压缩写入存档，未压缩的内容不会落盘，
+ * 也不需要整体读入内存。条目大小事先未知，因此本地文件头总是带 ZIP64
+ * 扩展字段，结束时回填 CRC32 和大小；超过 4GB 时自动写出 ZIP64 目录结构。
+ *
+ * threads > 1 时采用类似 pigz 的分块并行压缩：输入按约 1MB 切分成互相独立的
+ * deflate 块，由线程池并行压缩，每块以同步刷新 (sync flush) 结尾，按顺序
+ * 直接拼接成一个合法的 deflate 流，各块的 CRC32 再合并成整体 CRC32。块之间
+ * 不共享字典，压缩率比单线程流式压缩略低。
+ */
+class ZipStreamWriter {
+public:
+    ZipStreamWriter();
+    ~ZipStreamWriter();
+
+    ZipStreamWriter(const ZipStreamWriter&) = delete;
+    ZipStreamWriter& operator=(const ZipStreamWriter&) = delete;
+
+    /**
+     * @brief 创建存档并写入条目的本地文件头
+     *
+     * @param zipPath 目标 ZIP 文件路径
+     * @param entryName 存档内的文件名
+     * @param level 压缩级别 (0-10，同 MZ_DEFAULT_COMPRESSION 的取值范围)
+     * @param threads 压缩线程数，<= 1 表示单线程流式压缩
+     */
+    bool open(const std::string& zipPath, const std::string& entryName, int level, unsigned threads = 1);
+
+    /**
+     * @brief 压缩并写入一段数据
+     */
+    bool write(const char* data, std::size_t size);
+
+    /**
+     * @brief 结束压缩流，写出中央目录并回填本地文件头
+     */
+    bool close();
+
+    bool is_open() const { return m_file != nullptr; }
+
+private:
+    struct Deflater;
+
+    // 并行模式下的一个压缩块
+    struct Block {
+        std::string input;
+        std::string output;
+        std::size_t size = 0; // 输入长度，用于合并 CRC32
+        std::uint32_t crc = 0;
+        bool last = false;
+        bool done = false;
+        bool ok = false;
+    };
+
+    bool write_raw(const void* data, std::size_t size);
+    bool flush_output();
+    static int put_buf(const void* buf, int len, void* user);
+
+    void submit_block(bool last);
+    bool drain_blocks(std::size_t maxPending);
+    void compress_worker();
+
+    std::string m_path;
+    std::string m_entryName;
+    std::FILE* m_file = nullptr;
+    std::unique_ptr<Deflater> m_deflater;
+    std::string m_output;           // 压缩输出缓冲区
+    std::uint32_t m_crc = 0;
+    std::uint64_t m_uncompressed = 0;
+    std::uint64_t m_compressed = 0;
+    std::uint64_t m_offset = 0;     // 当前写入位置
+    std::uint16_t m_dosTime = 0;
+    std::uint16_t m_dosDate = 0;
+    bool m_failed = false;
+
+    // 并行压缩状态
+    int m_flags = 0;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workReady;
+    std::condition_variable m_blockDone;
+    std::deque<std::shared_ptr<Block>> m_queue;   // 等待压缩的块
+    std::deque<std::shared_ptr<Block>> m_pending; // 按顺序等待写出的块
+    std::shared_ptr<Block> m_current;             // 正在填充的块
+    bool m_stopping = false;
+};